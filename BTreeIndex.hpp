@@ -0,0 +1,535 @@
+/*
+  Copyright Benjamin Commeau
+
+Use CamelCase for all names. Start types (such as classes, structs, and typedefs) with a capital letter, other names (functions, variables) with a lowercase letter. You may use an all-lowercase name with underscores if your class closely resembles an external construct (e.g., a standard library construct) named that way.
+
+(1) C++ interfaces are named with a Interface suffix, and abstract base classes with an Abstract prefix.
+(2) Member variables are named with a trailing underscore.
+(3) Accessors for a variable foo_ are named foo() and setFoo().
+(4) Global variables are named with a g_ prefix.
+(5) Static class variables are named with a s_ prefix.
+(6) Global constants are often named with a c_ prefix.
+(7) If the main responsibility of a file is to implement a particular class, then the name of the file should match that class, except for possible abbreviations to avoid repetition in file names (e.g., if all classes within a module start with the module name, omitting or abbreviating the module name is OK). Currently, all source file names are lowercase, but this casing difference should be the only difference.
+
+The rationale for the trailing underscore and the global/static prefixes is that it is immediately clear whether a variable referenced in a method is local to the function or has wider scope, improving the readability of the code.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+/* //////////////////////////////////////////////////////////////
+Class Definition
+
+Ordered index of Map as a B+-tree.  Wide nodes keep the keys inline, and
+leaves keep each key next to the handle (list iterator) of its entry,
+so a search reads a few contiguous arrays instead of dereferencing two
+list nodes per comparison.  Leaves are linked for ordered iteration.
+
+Erasing never merges nodes; a node is freed when it becomes empty, so
+separators in inner nodes stay valid lower bounds of their children.
+Iterators are invalidated by insert and erase, like std::vector.
+See SetIndex.hpp for the interface shared by all indices of Map.
+*/ //////////////////////////////////////////////////////////////
+#ifndef BTREE_INDEX_HPP
+#define BTREE_INDEX_HPP
+template<class Key, class ListT, class Compare>
+class BTreeIndex {
+ public:
+  typedef typename ListT::iterator Handle;
+  static constexpr unsigned c_leaf =
+    std::max<unsigned>(8, 512/(sizeof(Key)+sizeof(Handle)));
+  static constexpr unsigned c_inner =
+    std::max<unsigned>(8, 512/(sizeof(Key)+sizeof(void*)));
+  static constexpr bool c_ordered = true;
+  static constexpr bool c_stable = false;
+  /* //////////////////////////////////////////////////////////////
+  Nodes, one slot of slack lets a node overflow before it splits
+  */ //////////////////////////////////////////////////////////////
+  struct Node {
+    bool leaf_; unsigned n_ = 0;
+    Node(bool leaf) : leaf_(leaf) {}
+  };
+  struct Leaf : Node {
+    Leaf() : Node(true) {}
+    Key key_[c_leaf+1]; Handle handle_[c_leaf+1];
+    Leaf* prev_ = nullptr; Leaf* next_ = nullptr;
+  };
+  struct Inner : Node {
+    Inner() : Node(false) {}
+    Key key_[c_inner+1]; Node* child_[c_inner+2];
+      /* child_[i] holds the keys in [key_[i-1],key_[i]) */
+  };
+  /* //////////////////////////////////////////////////////////////
+  Iterator over the leaves
+  */ //////////////////////////////////////////////////////////////
+  class iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = Handle;
+    using reference = const Handle&;
+    using pointer = const Handle*;
+    iterator() {}
+    iterator(const BTreeIndex* tree, Leaf* leaf, unsigned slot) :
+      tree_(tree), leaf_(leaf), slot_(slot) {}
+    const Handle& operator*() const {return leaf_->handle_[slot_];}
+    const Handle* operator->() const {return &leaf_->handle_[slot_];}
+    const Key& key() const {return leaf_->key_[slot_];}
+    iterator& operator++() {
+      if(++slot_ == leaf_->n_) {leaf_ = leaf_->next_; slot_ = 0;}
+      return *this;
+    }
+    iterator& operator--() {
+      if(leaf_ == nullptr) {
+        leaf_ = tree_->last_; slot_ = leaf_->n_;
+      } else if(slot_ == 0) {
+        leaf_ = leaf_->prev_; slot_ = leaf_->n_;
+      }
+      slot_--;
+      return *this;
+    }
+    iterator operator++(int) {iterator tmp = *this; ++(*this); return tmp;}
+    iterator operator--(int) {iterator tmp = *this; --(*this); return tmp;}
+    friend bool operator== (const iterator& a, const iterator& b)
+      {return a.leaf_ == b.leaf_ && a.slot_ == b.slot_;}
+    friend bool operator!= (const iterator& a, const iterator& b)
+      {return !(a == b);}
+   private:
+    friend class BTreeIndex;
+    const BTreeIndex* tree_ = nullptr;
+    Leaf* leaf_ = nullptr;
+    unsigned slot_ = 0;
+  };
+  /* //////////////////////////////////////////////////////////////
+  Implicit Methods
+  */ //////////////////////////////////////////////////////////////
+  BTreeIndex() {}
+  BTreeIndex(const BTreeIndex&) = delete;
+  BTreeIndex& operator=(const BTreeIndex&) = delete;
+  BTreeIndex(BTreeIndex&& rhs) {swap(rhs);}
+  BTreeIndex& operator=(BTreeIndex&& rhs) {clear(); swap(rhs); return *this;}
+  ~BTreeIndex() {clear();}
+  iterator begin() const
+    {return size_ == 0 ? end() : iterator(this, first_, 0);}
+  iterator end() const {return iterator(this, nullptr, 0);}
+  iterator find(const Key& key) const;
+  iterator lower_bound(const Key& key) const;
+  iterator upper_bound(const Key& key) const;
+  std::pair<iterator,bool> insert(const Key& key, const Handle& h);
+  iterator insert(iterator hint, const Key& key, const Handle& h);
+  void insert_sorted(const std::vector<std::pair<Key,Handle>>& items);
+  iterator erase(iterator it);
+  void clear();
+  std::size_t size() const {return size_;}
+  bool empty() const {return size_ == 0;}
+  unsigned height() const;
+ private:
+  struct Split {Node* right_ = nullptr; Key key_;};
+  Leaf* leaf(const Key& key) const;
+  iterator normalize(Leaf* leaf, unsigned slot) const;
+  Split insert(Node* node, const Key& key, const Handle& h,
+    iterator& pos, bool& inserted);
+  Split split(Leaf* leaf);
+  Split split(Inner* inner);
+  void load(const std::vector<std::pair<Key,Handle>>& items);
+  bool erase(Node* node, const Key& key, unsigned slot, Leaf*& next,
+    bool& removed);
+  void unlink(Leaf* leaf);
+  void destroy(Node* node);
+  void swap(BTreeIndex& rhs);
+  Node* root_ = nullptr;
+  Leaf* first_ = nullptr;
+  Leaf* last_ = nullptr;
+  std::size_t size_ = 0;
+  Compare compare_ = Compare();
+};
+
+/* //////////////////////////////////////////////////////////////
+Explicit Methods
+*/ //////////////////////////////////////////////////////////////
+
+template<class Key, class ListT, class Compare>
+typename BTreeIndex<Key, ListT, Compare>::
+Leaf*
+BTreeIndex<Key, ListT, Compare>::
+leaf(const Key& key) const {
+  Node* node = root_;
+  while(!node->leaf_) {
+    Inner* inner = static_cast<Inner*>(node);
+    unsigned i = std::upper_bound(inner->key_, inner->key_ + inner->n_, key,
+      compare_) - inner->key_;
+    node = inner->child_[i];
+  }
+  return static_cast<Leaf*>(node);
+}
+
+template<class Key, class ListT, class Compare>
+typename BTreeIndex<Key, ListT, Compare>::
+iterator
+BTreeIndex<Key, ListT, Compare>::
+normalize(Leaf* leaf, unsigned slot) const {
+  if(slot == leaf->n_) {return iterator(this, leaf->next_, 0);}
+  return iterator(this, leaf, slot);
+}
+
+template<class Key, class ListT, class Compare>
+typename BTreeIndex<Key, ListT, Compare>::
+iterator
+BTreeIndex<Key, ListT, Compare>::
+find(const Key& key) const {
+  if(size_ == 0) {return end();}
+  Leaf* l = leaf(key);
+  unsigned slot = std::lower_bound(l->key_, l->key_ + l->n_, key, compare_)
+    - l->key_;
+  if(slot == l->n_ || compare_(key, l->key_[slot])) {return end();}
+  return iterator(this, l, slot);
+}
+
+template<class Key, class ListT, class Compare>
+typename BTreeIndex<Key, ListT, Compare>::
+iterator
+BTreeIndex<Key, ListT, Compare>::
+lower_bound(const Key& key) const {
+  if(size_ == 0) {return end();}
+  Leaf* l = leaf(key);
+  return normalize(l, std::lower_bound(l->key_, l->key_ + l->n_, key,
+    compare_) - l->key_);
+}
+
+template<class Key, class ListT, class Compare>
+typename BTreeIndex<Key, ListT, Compare>::
+iterator
+BTreeIndex<Key, ListT, Compare>::
+upper_bound(const Key& key) const {
+  if(size_ == 0) {return end();}
+  Leaf* l = leaf(key);
+  return normalize(l, std::upper_bound(l->key_, l->key_ + l->n_, key,
+    compare_) - l->key_);
+}
+
+template<class Key, class ListT, class Compare>
+std::pair<typename BTreeIndex<Key, ListT, Compare>::iterator, bool>
+BTreeIndex<Key, ListT, Compare>::
+insert(const Key& key, const Handle& h) {
+  if(root_ == nullptr) {
+    first_ = last_ = new Leaf();
+    root_ = first_;
+  }
+  iterator pos;
+  bool inserted = false;
+  Split s = insert(root_, key, h, pos, inserted);
+  if(s.right_ != nullptr) {
+    Inner* root = new Inner();
+    root->n_ = 1;
+    root->key_[0] = s.key_;
+    root->child_[0] = root_;
+    root->child_[1] = s.right_;
+    root_ = root;
+  }
+  if(inserted) {size_++;}
+  return std::make_pair(pos, inserted);
+}
+
+template<class Key, class ListT, class Compare>
+typename BTreeIndex<Key, ListT, Compare>::
+iterator
+BTreeIndex<Key, ListT, Compare>::
+insert(iterator hint, const Key& key, const Handle& h) {
+  /* "hint" is lower_bound(key) with no modification since, the entry
+  goes in place when its leaf has room and surely covers key: a slot
+  past the first, the first leaf, or past the end of the last leaf */
+  Leaf* l = hint.leaf_;
+  unsigned slot = hint.slot_;
+  if(l != nullptr && !compare_(key, l->key_[slot])) {return hint;}
+  if(l == nullptr && last_ != nullptr) {l = last_; slot = l->n_;}
+  if(l == nullptr || l->n_ >= c_leaf || (slot == 0 && l->prev_ != nullptr)
+    || (slot > 0 && !compare_(l->key_[slot-1], key))) {
+    return insert(key, h).first;
+  }
+  std::copy_backward(l->key_ + slot, l->key_ + l->n_, l->key_ + l->n_ + 1);
+  std::copy_backward(l->handle_ + slot, l->handle_ + l->n_,
+    l->handle_ + l->n_ + 1);
+  l->key_[slot] = key;
+  l->handle_[slot] = h;
+  l->n_++;
+  size_++;
+  return iterator(this, l, slot);
+}
+
+template<class Key, class ListT, class Compare>
+void
+BTreeIndex<Key, ListT, Compare>::
+insert_sorted(const std::vector<std::pair<Key,Handle>>& items) {
+  /* a few items are inserted one by one, many are merged with the
+  entries and the tree is rebuilt bottom up */
+  if(items.size()*std::log2(double(size_) + 1) < size_) {
+    for(auto& item : items) {insert(item.first, item.second);}
+    return;
+  }
+  std::vector<std::pair<Key,Handle>> all;
+  all.reserve(size_ + items.size());
+  auto i = items.begin();
+  for(auto it = begin(); it != end(); it++) {
+    while(i != items.end() && compare_(i->first, it.key())) {
+      all.push_back(*i++);
+    }
+    all.emplace_back(it.key(), *it);
+  }
+  all.insert(all.end(), i, items.end());
+  clear();
+  load(all);
+}
+
+template<class Key, class ListT, class Compare>
+void
+BTreeIndex<Key, ListT, Compare>::
+load(const std::vector<std::pair<Key,Handle>>& items) {
+  /* entries are spread evenly, so every node is at least half full */
+  if(items.empty()) {return;}
+  std::vector<Node*> level;
+  std::vector<Key> low; // smallest key under each node of level
+  std::size_t n = items.size();
+  std::size_t m = (n + c_leaf - 1)/c_leaf;
+  for(std::size_t b = 0; b < m; b++) {
+    Leaf* l = new Leaf();
+    std::size_t i0 = (n*b)/m, i1 = (n*(b+1))/m;
+    for(std::size_t i = i0; i < i1; i++) {
+      l->key_[i-i0] = items[i].first;
+      l->handle_[i-i0] = items[i].second;
+    }
+    l->n_ = i1 - i0;
+    l->prev_ = last_;
+    if(last_ != nullptr) {last_->next_ = l;} else {first_ = l;}
+    last_ = l;
+    level.push_back(l);
+    low.push_back(l->key_[0]);
+  }
+  while(level.size() > 1) {
+    std::vector<Node*> up;
+    std::vector<Key> upLow;
+    n = level.size();
+    m = (n + c_inner)/(c_inner + 1);
+    for(std::size_t b = 0; b < m; b++) {
+      Inner* inner = new Inner();
+      std::size_t i0 = (n*b)/m, i1 = (n*(b+1))/m;
+      for(std::size_t i = i0; i < i1; i++) {
+        inner->child_[i-i0] = level[i];
+        if(i > i0) {inner->key_[i-i0-1] = low[i];}
+      }
+      inner->n_ = i1 - i0 - 1;
+      up.push_back(inner);
+      upLow.push_back(low[i0]);
+    }
+    level.swap(up);
+    low.swap(upLow);
+  }
+  root_ = level[0];
+  size_ = items.size();
+}
+
+template<class Key, class ListT, class Compare>
+typename BTreeIndex<Key, ListT, Compare>::
+Split
+BTreeIndex<Key, ListT, Compare>::
+insert(Node* node, const Key& key, const Handle& h, iterator& pos,
+  bool& inserted) {
+  if(node->leaf_) {
+    Leaf* l = static_cast<Leaf*>(node);
+    unsigned slot = std::lower_bound(l->key_, l->key_ + l->n_, key, compare_)
+      - l->key_;
+    if(slot < l->n_ && !compare_(key, l->key_[slot])) {
+      pos = iterator(this, l, slot);
+      return Split();
+    }
+    std::copy_backward(l->key_ + slot, l->key_ + l->n_, l->key_ + l->n_ + 1);
+    std::copy_backward(l->handle_ + slot, l->handle_ + l->n_,
+      l->handle_ + l->n_ + 1);
+    l->key_[slot] = key;
+    l->handle_[slot] = h;
+    l->n_++;
+    inserted = true;
+    if(l->n_ <= c_leaf) {
+      pos = iterator(this, l, slot);
+      return Split();
+    }
+    Split s = split(l);
+    if(slot < l->n_) {
+      pos = iterator(this, l, slot);
+    } else {
+      pos = iterator(this, static_cast<Leaf*>(s.right_), slot - l->n_);
+    }
+    return s;
+  }
+  Inner* inner = static_cast<Inner*>(node);
+  unsigned i = std::upper_bound(inner->key_, inner->key_ + inner->n_, key,
+    compare_) - inner->key_;
+  Split s = insert(inner->child_[i], key, h, pos, inserted);
+  if(s.right_ == nullptr) {return s;}
+  std::copy_backward(inner->key_ + i, inner->key_ + inner->n_,
+    inner->key_ + inner->n_ + 1);
+  std::copy_backward(inner->child_ + i + 1, inner->child_ + inner->n_ + 1,
+    inner->child_ + inner->n_ + 2);
+  inner->key_[i] = s.key_;
+  inner->child_[i+1] = s.right_;
+  inner->n_++;
+  if(inner->n_ <= c_inner) {return Split();}
+  return split(inner);
+}
+
+template<class Key, class ListT, class Compare>
+typename BTreeIndex<Key, ListT, Compare>::
+Split
+BTreeIndex<Key, ListT, Compare>::
+split(Leaf* l) {
+  Leaf* r = new Leaf();
+  unsigned mid = l->n_/2;
+  r->n_ = l->n_ - mid;
+  std::copy(l->key_ + mid, l->key_ + l->n_, r->key_);
+  std::copy(l->handle_ + mid, l->handle_ + l->n_, r->handle_);
+  l->n_ = mid;
+  r->prev_ = l; r->next_ = l->next_;
+  if(l->next_ != nullptr) {l->next_->prev_ = r;} else {last_ = r;}
+  l->next_ = r;
+  Split s;
+  s.right_ = r;
+  s.key_ = r->key_[0];
+  return s;
+}
+
+template<class Key, class ListT, class Compare>
+typename BTreeIndex<Key, ListT, Compare>::
+Split
+BTreeIndex<Key, ListT, Compare>::
+split(Inner* inner) {
+  /* the middle key moves up, its children stay on either side */
+  Inner* r = new Inner();
+  unsigned mid = inner->n_/2;
+  r->n_ = inner->n_ - mid - 1;
+  std::copy(inner->key_ + mid + 1, inner->key_ + inner->n_, r->key_);
+  std::copy(inner->child_ + mid + 1, inner->child_ + inner->n_ + 1,
+    r->child_);
+  Split s;
+  s.right_ = r;
+  s.key_ = inner->key_[mid];
+  inner->n_ = mid;
+  return s;
+}
+
+template<class Key, class ListT, class Compare>
+typename BTreeIndex<Key, ListT, Compare>::
+iterator
+BTreeIndex<Key, ListT, Compare>::
+erase(iterator it) {
+  Leaf* l = it.leaf_;
+  unsigned slot = it.slot_;
+  Key key = l->key_[slot];
+  Leaf* next = nullptr;
+  bool removed = false;
+  bool empty = erase(root_, key, slot, next, removed);
+  size_--;
+  if(empty) {
+    /* root leaf is kept, empty */
+    if(!root_->leaf_) {delete static_cast<Inner*>(root_); root_ = nullptr;}
+    return end();
+  }
+  while(!root_->leaf_ && root_->n_ == 0) {
+    Inner* inner = static_cast<Inner*>(root_);
+    root_ = inner->child_[0];
+    delete inner;
+  }
+  if(removed) {return iterator(this, next, 0);}
+  return normalize(l, slot);
+}
+
+template<class Key, class ListT, class Compare>
+bool
+BTreeIndex<Key, ListT, Compare>::
+erase(Node* node, const Key& key, unsigned slot, Leaf*& next,
+  bool& removed) {
+  /* returns true when node is left empty, "next" is set to the leaf
+  after a removed leaf */
+  if(node->leaf_) {
+    Leaf* l = static_cast<Leaf*>(node);
+    std::copy(l->key_ + slot + 1, l->key_ + l->n_, l->key_ + slot);
+    std::copy(l->handle_ + slot + 1, l->handle_ + l->n_, l->handle_ + slot);
+    l->n_--;
+    return l->n_ == 0;
+  }
+  Inner* inner = static_cast<Inner*>(node);
+  unsigned i = std::upper_bound(inner->key_, inner->key_ + inner->n_, key,
+    compare_) - inner->key_;
+  Node* child = inner->child_[i];
+  if(!erase(child, key, slot, next, removed)) {return false;}
+  if(child->leaf_) {
+    removed = true;
+    next = static_cast<Leaf*>(child)->next_;
+    unlink(static_cast<Leaf*>(child));
+    delete static_cast<Leaf*>(child);
+  } else {
+    delete static_cast<Inner*>(child);
+  }
+  if(inner->n_ == 0) {return true;}
+  unsigned k = (i == 0) ? 0 : i - 1;
+  std::copy(inner->key_ + k + 1, inner->key_ + inner->n_, inner->key_ + k);
+  std::copy(inner->child_ + i + 1, inner->child_ + inner->n_ + 1,
+    inner->child_ + i);
+  inner->n_--;
+  return false;
+}
+
+template<class Key, class ListT, class Compare>
+void
+BTreeIndex<Key, ListT, Compare>::
+unlink(Leaf* l) {
+  if(l->prev_ != nullptr) {l->prev_->next_ = l->next_;} else {first_ = l->next_;}
+  if(l->next_ != nullptr) {l->next_->prev_ = l->prev_;} else {last_ = l->prev_;}
+}
+
+template<class Key, class ListT, class Compare>
+void
+BTreeIndex<Key, ListT, Compare>::
+clear() {
+  if(root_ != nullptr) {destroy(root_);}
+  root_ = nullptr; first_ = nullptr; last_ = nullptr;
+  size_ = 0;
+}
+
+template<class Key, class ListT, class Compare>
+void
+BTreeIndex<Key, ListT, Compare>::
+destroy(Node* node) {
+  if(node->leaf_) {delete static_cast<Leaf*>(node); return;}
+  Inner* inner = static_cast<Inner*>(node);
+  for(unsigned i = 0; i <= inner->n_; i++) {destroy(inner->child_[i]);}
+  delete inner;
+}
+
+template<class Key, class ListT, class Compare>
+void
+BTreeIndex<Key, ListT, Compare>::
+swap(BTreeIndex& rhs) {
+  std::swap(root_, rhs.root_);
+  std::swap(first_, rhs.first_);
+  std::swap(last_, rhs.last_);
+  std::swap(size_, rhs.size_);
+}
+
+template<class Key, class ListT, class Compare>
+unsigned
+BTreeIndex<Key, ListT, Compare>::
+height() const {
+  unsigned h = 0;
+  for(Node* node = root_; node != nullptr; h++) {
+    node = node->leaf_ ? nullptr : static_cast<Inner*>(node)->child_[0];
+  }
+  return h;
+}
+
+/*
+endend
+*/
+
+#endif
@@ -0,0 +1,167 @@
+/*
+  Copyright Benjamin Commeau
+
+Use CamelCase for all names. Start types (such as classes, structs, and typedefs) with a capital letter, other names (functions, variables) with a lowercase letter. You may use an all-lowercase name with underscores if your class closely resembles an external construct (e.g., a standard library construct) named that way.
+
+(1) C++ interfaces are named with a Interface suffix, and abstract base classes with an Abstract prefix.
+(2) Member variables are named with a trailing underscore.
+(3) Accessors for a variable foo_ are named foo() and setFoo().
+(4) Global variables are named with a g_ prefix.
+(5) Static class variables are named with a s_ prefix.
+(6) Global constants are often named with a c_ prefix.
+(7) If the main responsibility of a file is to implement a particular class, then the name of the file should match that class, except for possible abbreviations to avoid repetition in file names (e.g., if all classes within a module start with the module name, omitting or abbreviating the module name is OK). Currently, all source file names are lowercase, but this casing difference should be the only difference.
+
+The rationale for the trailing underscore and the global/static prefixes is that it is immediately clear whether a variable referenced in a method is local to the function or has wider scope, improving the readability of the code.
+*/
+
+#include <complex>
+#include <cstddef>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+/* //////////////////////////////////////////////////////////////
+Class Definition
+
+Inner loops on std::complex<double>, whose layout is two doubles (re,im).
+With SSE2 one register holds one complex number.  A sparse dot product
+keeps two sums, sum(a*re(x)) and sum(a*im(x)), and combines them once at
+the end, so each term costs two multiplies and two adds and never the
+shuffles of a full complex multiply.  Without SSE2 the same sums are
+done in scalar code, and the results agree up to rounding.  mul() is
+the product for gather loops that keep one term per row, and xorMulAdd()
+the streaming pass y[i] += d[i]*x[i ^ mask] of one diagonal.
+xorSignMulAdd() is that pass for a diagonal c*sign[i] with real signs: c
+stays in registers and x is multiplied by it as a whole register, so it
+reads 8 bytes of diagonal per row instead of 16.
+*/ //////////////////////////////////////////////////////////////
+#ifndef COMPLEX_KERNEL_HPP
+#define COMPLEX_KERNEL_HPP
+class ComplexKernel {
+ public:
+  typedef std::complex<double> Value;
+  template<class Index>
+  static Value dot(const Value* a, const Index* idx, std::size_t n,
+    const Value* x);
+  static void xorMulAdd(const Value* d, const Value* x, std::size_t mask,
+    Value* y, std::size_t begin, std::size_t end);
+  static void xorSignMulAdd(const Value& c, const double* sign,
+    const Value* x, std::size_t mask, Value* y, std::size_t begin,
+    std::size_t end);
+  static Value mul(const Value& a, const Value& b) {
+    /* a*b as four multiplies and two adds, without the inf/nan recovery
+    of operator*, which keeps loops of products free of library calls */
+    return Value(a.real()*b.real() - a.imag()*b.imag(),
+      a.real()*b.imag() + a.imag()*b.real());
+  }
+};
+
+/* //////////////////////////////////////////////////////////////
+Explicit Methods
+*/ //////////////////////////////////////////////////////////////
+
+template<class Index>
+ComplexKernel::
+Value
+ComplexKernel::
+dot(const Value* a, const Index* idx, std::size_t n, const Value* x) {
+  /* sum over i of a[i]*x[idx[i]] */
+#if defined(__SSE2__)
+  const double* pa = reinterpret_cast<const double*>(a);
+  const double* px = reinterpret_cast<const double*>(x);
+  __m128d re = _mm_setzero_pd(); // (sum ar*xr, sum ai*xr)
+  __m128d im = _mm_setzero_pd(); // (sum ar*xi, sum ai*xi)
+  __m128d reOdd = _mm_setzero_pd(); // odd terms, two chains hide the
+  __m128d imOdd = _mm_setzero_pd(); // latency of the adds
+  std::size_t i = 0;
+  for(; i + 1 < n; i += 2) {
+    __m128d va = _mm_loadu_pd(pa + 2*i);
+    __m128d vb = _mm_loadu_pd(pa + 2*i + 2);
+    const double* pxa = px + 2*std::size_t(idx[i]);
+    const double* pxb = px + 2*std::size_t(idx[i+1]);
+    re = _mm_add_pd(re, _mm_mul_pd(va, _mm_set1_pd(pxa[0])));
+    im = _mm_add_pd(im, _mm_mul_pd(va, _mm_set1_pd(pxa[1])));
+    reOdd = _mm_add_pd(reOdd, _mm_mul_pd(vb, _mm_set1_pd(pxb[0])));
+    imOdd = _mm_add_pd(imOdd, _mm_mul_pd(vb, _mm_set1_pd(pxb[1])));
+  }
+  if(i < n) {
+    __m128d va = _mm_loadu_pd(pa + 2*i);
+    const double* pxa = px + 2*std::size_t(idx[i]);
+    re = _mm_add_pd(re, _mm_mul_pd(va, _mm_set1_pd(pxa[0])));
+    im = _mm_add_pd(im, _mm_mul_pd(va, _mm_set1_pd(pxa[1])));
+  }
+  re = _mm_add_pd(re, reOdd);
+  im = _mm_add_pd(im, imOdd);
+  /* lanes (re[0] - im[1], re[1] + im[0]) */
+  __m128d swapped = _mm_shuffle_pd(im, im, 1);
+  __m128d sign = _mm_set_pd(1.0, -1.0);
+  double out[2];
+  _mm_storeu_pd(out, _mm_add_pd(re, _mm_mul_pd(swapped, sign)));
+  return Value(out[0], out[1]);
+#else
+  double rr = 0; double ir = 0; double ri = 0; double ii = 0;
+  for(std::size_t i = 0; i < n; i++) {
+    const Value& xi = x[idx[i]];
+    rr += a[i].real()*xi.real(); ir += a[i].imag()*xi.real();
+    ri += a[i].real()*xi.imag(); ii += a[i].imag()*xi.imag();
+  }
+  return Value(rr - ii, ir + ri);
+#endif
+}
+
+void
+ComplexKernel::
+xorMulAdd(const Value* d, const Value* x, std::size_t mask, Value* y,
+  std::size_t begin, std::size_t end) {
+  /* y[i] += d[i]*x[i ^ mask] for i in [begin,end); d, x and y are each
+  read in order, x in runs permuted by the low bits of mask */
+#if defined(__SSE2__)
+  const double* pd = reinterpret_cast<const double*>(d);
+  const double* px = reinterpret_cast<const double*>(x);
+  double* py = reinterpret_cast<double*>(y);
+  const __m128d sign = _mm_set_pd(1.0, -1.0);
+  for(std::size_t i = begin; i < end; i++) {
+    /* (dr*xr - di*xi, di*xr + dr*xi) */
+    __m128d vd = _mm_loadu_pd(pd + 2*i);
+    const double* pxi = px + 2*(i ^ mask);
+    __m128d swapped = _mm_shuffle_pd(vd, vd, 1);
+    __m128d prod = _mm_add_pd(_mm_mul_pd(vd, _mm_set1_pd(pxi[0])),
+      _mm_mul_pd(_mm_mul_pd(swapped, _mm_set1_pd(pxi[1])), sign));
+    _mm_storeu_pd(py + 2*i, _mm_add_pd(_mm_loadu_pd(py + 2*i), prod));
+  }
+#else
+  for(std::size_t i = begin; i < end; i++) {
+    y[i] += mul(d[i], x[i ^ mask]);
+  }
+#endif
+}
+
+void
+ComplexKernel::
+xorSignMulAdd(const Value& c, const double* sign, const Value* x,
+  std::size_t mask, Value* y, std::size_t begin, std::size_t end) {
+  /* y[i] += sign[i]*c*x[i ^ mask] for i in [begin,end) */
+#if defined(__SSE2__)
+  const double* px = reinterpret_cast<const double*>(x);
+  double* py = reinterpret_cast<double*>(y);
+  const __m128d cr = _mm_set1_pd(c.real());
+  const __m128d ci = _mm_set_pd(c.imag(), -c.imag());
+  for(std::size_t i = begin; i < end; i++) {
+    /* (cr*xr - ci*xi, cr*xi + ci*xr) */
+    __m128d vx = _mm_loadu_pd(px + 2*(i ^ mask));
+    __m128d swapped = _mm_shuffle_pd(vx, vx, 1);
+    __m128d prod = _mm_add_pd(_mm_mul_pd(cr, vx), _mm_mul_pd(ci, swapped));
+    _mm_storeu_pd(py + 2*i, _mm_add_pd(_mm_loadu_pd(py + 2*i),
+      _mm_mul_pd(_mm_set1_pd(sign[i]), prod)));
+  }
+#else
+  for(std::size_t i = begin; i < end; i++) {
+    y[i] += sign[i]*mul(c, x[i ^ mask]);
+  }
+#endif
+}
+
+/*
+endend
+*/
+
+#endif
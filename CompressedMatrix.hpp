@@ -0,0 +1,140 @@
+/*
+  Copyright Benjamin Commeau
+
+Use CamelCase for all names. Start types (such as classes, structs, and typedefs) with a capital letter, other names (functions, variables) with a lowercase letter. You may use an all-lowercase name with underscores if your class closely resembles an external construct (e.g., a standard library construct) named that way.
+
+(1) C++ interfaces are named with a Interface suffix, and abstract base classes with an Abstract prefix.
+(2) Member variables are named with a trailing underscore.
+(3) Accessors for a variable foo_ are named foo() and setFoo().
+(4) Global variables are named with a g_ prefix.
+(5) Static class variables are named with a s_ prefix.
+(6) Global constants are often named with a c_ prefix.
+(7) If the main responsibility of a file is to implement a particular class, then the name of the file should match that class, except for possible abbreviations to avoid repetition in file names (e.g., if all classes within a module start with the module name, omitting or abbreviating the module name is OK). Currently, all source file names are lowercase, but this casing difference should be the only difference.
+
+The rationale for the trailing underscore and the global/static prefixes is that it is immediately clear whether a variable referenced in a method is local to the function or has wider scope, improving the readability of the code.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+/* //////////////////////////////////////////////////////////////
+Class Definition
+
+Compressed sparse row snapshot: row r holds the entries
+[ptr_[r], ptr_[r+1]) of idx_ (column indices, increasing) and val_.
+The compressed columns (CSC) of a matrix are the compressed rows of its
+transpose, so one class serves both and transposed() converts between
+them by a counting sort in O(nnz + rows + cols).  A snapshot owns flat
+arrays and does not follow later changes of the matrix it came from.
+*/ //////////////////////////////////////////////////////////////
+#ifndef COMPRESSED_MATRIX_HPP
+#define COMPRESSED_MATRIX_HPP
+template<class Index, class Value>
+class CompressedMatrix {
+ public:
+  /* //////////////////////////////////////////////////////////////
+  Implicit Methods
+  */ //////////////////////////////////////////////////////////////
+  CompressedMatrix() : ptr_(1, 0) {}
+  Index rows() const {return Index(ptr_.size() - 1);}
+  Index cols() const {return cols_;}
+  std::size_t nnz() const {return idx_.size();}
+  const std::vector<std::size_t>& ptr() const {return ptr_;}
+  const std::vector<Index>& idx() const {return idx_;}
+  const std::vector<Value>& val() const {return val_;}
+  std::vector<Value>& val() {return val_;}
+  void reserve(std::size_t nnz) {idx_.reserve(nnz); val_.reserve(nnz);}
+  void append(Index x, Index y, const Value& v);
+  void resize(Index rows, Index cols);
+  void assign(std::vector<std::size_t>&& ptr, std::vector<Index>&& idx,
+    std::vector<Value>&& val, Index cols);
+  CompressedMatrix transposed() const;
+  template<class Visit> void forEach(Visit visit) const;
+ private:
+  std::vector<std::size_t> ptr_;
+  std::vector<Index> idx_;
+  std::vector<Value> val_;
+  Index cols_ = 0;
+};
+
+/* //////////////////////////////////////////////////////////////
+Explicit Methods
+*/ //////////////////////////////////////////////////////////////
+
+template<class Index, class Value>
+void
+CompressedMatrix<Index, Value>::
+append(Index x, Index y, const Value& v) {
+  /* entries come in row-major order, rows and cols grow to fit them;
+  resize() afterwards adds empty trailing rows or columns */
+  while(rows() <= x) {ptr_.push_back(idx_.size());}
+  cols_ = std::max(cols_, Index(y+1));
+  idx_.push_back(y);
+  val_.push_back(v);
+  ptr_.back() = idx_.size();
+}
+
+template<class Index, class Value>
+void
+CompressedMatrix<Index, Value>::
+resize(Index rows, Index cols) {
+  /* only grows, the entries stay */
+  while(this->rows() < rows) {ptr_.push_back(idx_.size());}
+  cols_ = std::max(cols_, cols);
+}
+
+template<class Index, class Value>
+void
+CompressedMatrix<Index, Value>::
+assign(std::vector<std::size_t>&& ptr, std::vector<Index>&& idx,
+  std::vector<Value>&& val, Index cols) {
+  /* takes arrays filled elsewhere, e.g. by rows in parallel; ptr holds
+  rows+1 offsets starting at 0 */
+  ptr_ = std::move(ptr);
+  idx_ = std::move(idx);
+  val_ = std::move(val);
+  cols_ = cols;
+}
+
+template<class Index, class Value>
+CompressedMatrix<Index, Value>
+CompressedMatrix<Index, Value>::
+transposed() const {
+  CompressedMatrix t;
+  t.ptr_.assign(std::size_t(cols_)+1, 0);
+  t.cols_ = rows();
+  t.idx_.resize(nnz());
+  t.val_.resize(nnz());
+  for(auto y : idx_) {t.ptr_[y+1]++;}
+  for(std::size_t c = 0; c < cols_; c++) {t.ptr_[c+1] += t.ptr_[c];}
+  /* rows are visited in order, so each column comes out sorted */
+  std::vector<std::size_t> next(t.ptr_.begin(), t.ptr_.end()-1);
+  for(Index x = 0; x < rows(); x++) {
+    for(std::size_t i = ptr_[x]; i < ptr_[x+1]; i++) {
+      std::size_t j = next[idx_[i]]++;
+      t.idx_[j] = x;
+      t.val_[j] = val_[i];
+    }
+  }
+  return t;
+}
+
+template<class Index, class Value>
+template<class Visit>
+void
+CompressedMatrix<Index, Value>::
+forEach(Visit visit) const {
+  /* visit(x, y, v) in row-major order */
+  for(Index x = 0; x < rows(); x++) {
+    for(std::size_t i = ptr_[x]; i < ptr_[x+1]; i++) {
+      visit(x, idx_[i], val_[i]);
+    }
+  }
+}
+
+/*
+endend
+*/
+
+#endif
@@ -0,0 +1,181 @@
+/*
+  Copyright Benjamin Commeau
+
+Use CamelCase for all names. Start types (such as classes, structs, and typedefs) with a capital letter, other names (functions, variables) with a lowercase letter. You may use an all-lowercase name with underscores if your class closely resembles an external construct (e.g., a standard library construct) named that way.
+
+(1) C++ interfaces are named with a Interface suffix, and abstract base classes with an Abstract prefix.
+(2) Member variables are named with a trailing underscore.
+(3) Accessors for a variable foo_ are named foo() and setFoo().
+(4) Global variables are named with a g_ prefix.
+(5) Static class variables are named with a s_ prefix.
+(6) Global constants are often named with a c_ prefix.
+(7) If the main responsibility of a file is to implement a particular class, then the name of the file should match that class, except for possible abbreviations to avoid repetition in file names (e.g., if all classes within a module start with the module name, omitting or abbreviating the module name is OK). Currently, all source file names are lowercase, but this casing difference should be the only difference.
+
+The rationale for the trailing underscore and the global/static prefixes is that it is immediately clear whether a variable referenced in a method is local to the function or has wider scope, improving the readability of the code.
+*/
+
+#include <algorithm>
+#include <complex>
+#include <cstdint>
+#include <vector>
+/* //////////////////////////////////////////////////////////////
+Class Definition
+
+Row-by-row (Gustavson) sparse product C += L*R.  The right operand R
+is loaded once as (x,y,v) entries and bucketed by its row x, with its
+column indices y compressed to dense ranks.  Each row of L is then
+multiplied by scattering a(k)*R(k,:) into an Accumulator, which is
+gathered in increasing column order.  Only the rows of R reached
+through nonzeros of L are touched, so the work is proportional to the
+number of flops instead of rows(L)*nnz(R).
+*/ //////////////////////////////////////////////////////////////
+#ifndef GUSTAVSON_HPP
+#define GUSTAVSON_HPP
+template<class Index, class Value>
+class Gustavson {
+ public:
+  /* //////////////////////////////////////////////////////////////
+  Entry of an operand
+  */ //////////////////////////////////////////////////////////////
+  struct Entry {
+    Index x_; Index y_; Value v_;
+    Entry() {}
+    Entry(const Index& x, const Index& y, const Value& v) :
+      x_(x), y_(y), v_(v) {}
+    bool operator <(const Entry& e) const {
+      return x_ != e.x_ ? x_ < e.x_ : y_ < e.y_;
+    }
+  };
+  /* //////////////////////////////////////////////////////////////
+  Dense scratch row over the compressed columns of R
+  */ //////////////////////////////////////////////////////////////
+  class Accumulator {
+   public:
+    Accumulator() {}
+    Accumulator(const Gustavson& g) {resize(g);}
+    void resize(const Gustavson& g);
+    bool empty() const {return touched_.empty();}
+    template<class Emit> void gather(const Gustavson& g, Emit emit);
+   private:
+    friend class Gustavson;
+    std::vector<Value> val_;
+    std::vector<char> mark_;
+    std::vector<Index> touched_;
+  };
+  /* //////////////////////////////////////////////////////////////
+  Implicit Methods
+  */ //////////////////////////////////////////////////////////////
+  void setRight(std::vector<Entry>& entries);
+  void scatter(Accumulator& acc, const Index& k, const Value& a) const;
+  void scatter(Accumulator& acc, const Index& k, const Value& a,
+    std::size_t& hint) const;
+  std::size_t cols() const {return cols_.size();}
+  std::size_t nnz() const {return idx_.size();}
+  Index col(const Index& rank) const {return cols_[rank];}
+ private:
+  std::vector<Index> cols_; // distinct column indices of R, ascending
+  std::vector<Index> rows_; // distinct row indices of R, ascending
+  std::vector<std::size_t> ptr_; // rows_[i] spans [ptr_[i],ptr_[i+1])
+  std::vector<Index> idx_; // column ranks into cols_
+  std::vector<Value> val_;
+};
+
+/* //////////////////////////////////////////////////////////////
+Explicit Methods
+*/ //////////////////////////////////////////////////////////////
+
+template<class Index, class Value>
+void
+Gustavson<Index, Value>::
+setRight(std::vector<Entry>& entries) {
+  cols_.resize(entries.size());
+  for(std::size_t i = 0; i < entries.size(); i++) {
+    cols_[i] = entries[i].y_;
+  }
+  std::sort(cols_.begin(), cols_.end());
+  cols_.erase(std::unique(cols_.begin(), cols_.end()), cols_.end());
+  for(auto& e : entries) {
+    e.y_ = Index(std::lower_bound(cols_.begin(), cols_.end(), e.y_)
+      - cols_.begin());
+  }
+  /* the ranks keep the order of the columns, so entries given in
+  row-major order stay sorted */
+  if(!std::is_sorted(entries.begin(), entries.end())) {
+    std::sort(entries.begin(), entries.end());
+  }
+  rows_.clear(); ptr_.clear();
+  idx_.resize(entries.size()); val_.resize(entries.size());
+  for(std::size_t i = 0; i < entries.size(); i++) {
+    if(rows_.empty() || rows_.back() != entries[i].x_) {
+      rows_.push_back(entries[i].x_);
+      ptr_.push_back(i);
+    }
+    idx_[i] = entries[i].y_;
+    val_[i] = entries[i].v_;
+  }
+  ptr_.push_back(entries.size());
+}
+
+template<class Index, class Value>
+void
+Gustavson<Index, Value>::
+scatter(Accumulator& acc, const Index& k, const Value& a) const {
+  std::size_t hint = 0;
+  scatter(acc, k, a, hint);
+}
+
+template<class Index, class Value>
+void
+Gustavson<Index, Value>::
+scatter(Accumulator& acc, const Index& k, const Value& a,
+  std::size_t& hint) const {
+  /* "hint" is the position of the previous row of R, so a row of L
+  visited in increasing k only searches forward */
+  if(hint >= rows_.size() || rows_[hint] > k) {
+    hint = 0;
+  }
+  hint = std::lower_bound(rows_.begin() + hint, rows_.end(), k)
+    - rows_.begin();
+  if(hint == rows_.size() || rows_[hint] != k) {return;}
+  for(std::size_t i = ptr_[hint]; i < ptr_[hint+1]; i++) {
+    Index j = idx_[i];
+    if(acc.mark_[j]) {
+      acc.val_[j] += a * val_[i];
+    } else {
+      acc.mark_[j] = 1;
+      acc.val_[j] = a * val_[i];
+      acc.touched_.push_back(j);
+    }
+  }
+}
+
+template<class Index, class Value>
+void
+Gustavson<Index, Value>::
+Accumulator::
+resize(const Gustavson& g) {
+  val_.assign(g.cols(), Value(0));
+  mark_.assign(g.cols(), 0);
+  touched_.clear();
+  touched_.reserve(g.cols());
+}
+
+template<class Index, class Value>
+template<class Emit>
+void
+Gustavson<Index, Value>::
+Accumulator::
+gather(const Gustavson& g, Emit emit) {
+  std::sort(touched_.begin(), touched_.end());
+  for(auto j : touched_) {
+    emit(g.col(j), val_[j]);
+    mark_[j] = 0;
+  }
+  touched_.clear();
+}
+
+/*
+endend
+*/
+
+#endif
@@ -0,0 +1,318 @@
+/*
+  Copyright Benjamin Commeau
+
+Use CamelCase for all names. Start types (such as classes, structs, and typedefs) with a capital letter, other names (functions, variables) with a lowercase letter. You may use an all-lowercase name with underscores if your class closely resembles an external construct (e.g., a standard library construct) named that way.
+
+(1) C++ interfaces are named with a Interface suffix, and abstract base classes with an Abstract prefix.
+(2) Member variables are named with a trailing underscore.
+(3) Accessors for a variable foo_ are named foo() and setFoo().
+(4) Global variables are named with a g_ prefix.
+(5) Static class variables are named with a s_ prefix.
+(6) Global constants are often named with a c_ prefix.
+(7) If the main responsibility of a file is to implement a particular class, then the name of the file should match that class, except for possible abbreviations to avoid repetition in file names (e.g., if all classes within a module start with the module name, omitting or abbreviating the module name is OK). Currently, all source file names are lowercase, but this casing difference should be the only difference.
+
+The rationale for the trailing underscore and the global/static prefixes is that it is immediately clear whether a variable referenced in a method is local to the function or has wider scope, improving the readability of the code.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <utility>
+#include <vector>
+/* //////////////////////////////////////////////////////////////
+Class Definition
+
+Hashed index of Map for point lookups.  An open-addressing table with
+linear probing keeps each key inline next to the handle (list iterator)
+of its entry, so find and insert cost about one cache miss.  Deletion
+shifts the following entries back, so the table never holds tombstones.
+
+Ordered iteration walks a sorted copy of the handles that is rebuilt on
+demand, after any insert or erase, by begin(), --end(), lower_bound()
+and upper_bound().  Iterators returned by find and insert point into
+the table; stepping them moves to their place in the sorted copy.
+erase() returns end() rather than rebuilding the sorted copy.
+Iterators are invalidated by insert and erase, like std::vector.
+The rebuild is locked, so const methods are safe from many threads
+while no thread writes.
+See SetIndex.hpp for the interface shared by all indices of Map.
+*/ //////////////////////////////////////////////////////////////
+#ifndef HASH_INDEX_HPP
+#define HASH_INDEX_HPP
+template<class Key, class ListT, class Compare, class Hash = std::hash<Key>>
+class HashIndex {
+ public:
+  typedef typename ListT::iterator Handle;
+  struct Slot {
+    Key key_; Handle h_; bool used_ = false;
+  };
+  static constexpr bool c_ordered = false;
+  static constexpr bool c_stable = false;
+  /* //////////////////////////////////////////////////////////////
+  Iterator over the table or the sorted copy
+  */ //////////////////////////////////////////////////////////////
+  class iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = Handle;
+    using reference = const Handle&;
+    using pointer = const Handle*;
+    iterator() {}
+    iterator(const HashIndex* index, const Handle* p) :
+      index_(index), p_(p) {}
+    const Handle& operator*() const {return *p_;}
+    const Handle* operator->() const {return p_;}
+    iterator& operator++() {
+      p_ = index_->ordered(p_) + 1;
+      if(p_ == index_->order_.data() + index_->order_.size()) {p_ = nullptr;}
+      return *this;
+    }
+    iterator& operator--() {
+      if(p_ == nullptr) {
+        index_->sort();
+        p_ = index_->order_.data() + index_->order_.size() - 1;
+      } else {
+        p_ = index_->ordered(p_) - 1;
+      }
+      return *this;
+    }
+    iterator operator++(int) {iterator tmp = *this; ++(*this); return tmp;}
+    iterator operator--(int) {iterator tmp = *this; --(*this); return tmp;}
+    friend bool operator== (const iterator& a, const iterator& b) {
+      /* a table slot and a sorted position of the same entry are equal */
+      if(a.p_ == nullptr || b.p_ == nullptr) {return a.p_ == b.p_;}
+      return *a.p_ == *b.p_;
+    }
+    friend bool operator!= (const iterator& a, const iterator& b)
+      {return !(a == b);}
+   private:
+    friend class HashIndex;
+    const HashIndex* index_ = nullptr;
+    const Handle* p_ = nullptr;
+  };
+  /* //////////////////////////////////////////////////////////////
+  Implicit Methods
+  */ //////////////////////////////////////////////////////////////
+  iterator begin() const;
+  iterator end() const {return iterator(this, nullptr);}
+  iterator find(const Key& key) const;
+  iterator lower_bound(const Key& key) const;
+  iterator upper_bound(const Key& key) const;
+  std::pair<iterator,bool> insert(const Key& key, const Handle& h);
+  iterator insert(iterator, const Key& key, const Handle& h)
+    {return insert(key, h).first;}
+  void insert_sorted(const std::vector<std::pair<Key,Handle>>& items);
+  iterator erase(iterator it);
+  void clear();
+  std::size_t size() const {return size_;}
+  bool empty() const {return size_ == 0;}
+  std::size_t capacity() const {return slots_.size();}
+  HashIndex() {}
+  HashIndex(const HashIndex&) = delete;
+  HashIndex& operator=(const HashIndex&) = delete;
+ private:
+  std::size_t bucket(const Key& key) const {
+    return (std::size_t(hash_(key))*UINT64_C(0x9E3779B97F4A7C15)) >> shift_;
+  }
+  bool equal(const Key& a, const Key& b) const
+    {return !compare_(a, b) && !compare_(b, a);}
+  std::size_t probe(const Key& key) const;
+  void rehash(std::size_t capacity);
+  void sort() const;
+  const Handle* ordered(const Handle* p) const;
+  std::vector<Slot> slots_;
+  std::size_t size_ = 0;
+  std::size_t mask_ = 0;
+  unsigned shift_ = 64;
+  mutable std::vector<Handle> order_;
+  mutable std::atomic<bool> sorted_ = true;
+  mutable std::mutex sort_mutex_;
+  Hash hash_ = Hash();
+  Compare compare_ = Compare();
+};
+
+/* //////////////////////////////////////////////////////////////
+Explicit Methods
+*/ //////////////////////////////////////////////////////////////
+
+template<class Key, class ListT, class Compare, class Hash>
+std::size_t
+HashIndex<Key, ListT, Compare, Hash>::
+probe(const Key& key) const {
+  /* slot holding key, or the empty slot ending its probe sequence */
+  std::size_t i = bucket(key);
+  while(slots_[i].used_ && !equal(slots_[i].key_, key)) {
+    i = (i + 1) & mask_;
+  }
+  return i;
+}
+
+template<class Key, class ListT, class Compare, class Hash>
+void
+HashIndex<Key, ListT, Compare, Hash>::
+rehash(std::size_t capacity) {
+  std::vector<Slot> old(capacity);
+  old.swap(slots_);
+  mask_ = capacity - 1;
+  shift_ = 64;
+  while(capacity > 1) {capacity >>= 1; shift_--;}
+  for(auto& s : old) {
+    if(s.used_) {slots_[probe(s.key_)] = s;}
+  }
+}
+
+template<class Key, class ListT, class Compare, class Hash>
+void
+HashIndex<Key, ListT, Compare, Hash>::
+sort() const {
+  if(sorted_.load(std::memory_order_acquire)) {return;}
+  std::lock_guard<std::mutex> lock(sort_mutex_);
+  if(sorted_.load(std::memory_order_relaxed)) {return;}
+  std::vector<Slot> tmp;
+  tmp.reserve(size_);
+  for(auto& s : slots_) {
+    if(s.used_) {tmp.push_back(s);}
+  }
+  std::sort(tmp.begin(), tmp.end(), [&](const Slot& a, const Slot& b) {
+    return compare_(a.key_, b.key_);
+  });
+  order_.resize(tmp.size());
+  for(std::size_t i = 0; i < tmp.size(); i++) {order_[i] = tmp[i].h_;}
+  sorted_.store(true, std::memory_order_release);
+}
+
+template<class Key, class ListT, class Compare, class Hash>
+const typename HashIndex<Key, ListT, Compare, Hash>::
+Handle*
+HashIndex<Key, ListT, Compare, Hash>::
+ordered(const Handle* p) const {
+  /* position of the entry of p in the sorted copy */
+  sort();
+  const Handle* first = order_.data();
+  const Handle* last = first + order_.size();
+  if(!std::less<const Handle*>()(p, first)
+    && std::less<const Handle*>()(p, last)) {
+    return p;
+  }
+  return std::lower_bound(first, last, (*p)->key(),
+    [&](const Handle& h, const Key& key) {return compare_(h->key(), key);});
+}
+
+template<class Key, class ListT, class Compare, class Hash>
+typename HashIndex<Key, ListT, Compare, Hash>::
+iterator
+HashIndex<Key, ListT, Compare, Hash>::
+begin() const {
+  if(size_ == 0) {return end();}
+  sort();
+  return iterator(this, order_.data());
+}
+
+template<class Key, class ListT, class Compare, class Hash>
+typename HashIndex<Key, ListT, Compare, Hash>::
+iterator
+HashIndex<Key, ListT, Compare, Hash>::
+find(const Key& key) const {
+  if(size_ == 0) {return end();}
+  std::size_t i = probe(key);
+  if(!slots_[i].used_) {return end();}
+  return iterator(this, &slots_[i].h_);
+}
+
+template<class Key, class ListT, class Compare, class Hash>
+typename HashIndex<Key, ListT, Compare, Hash>::
+iterator
+HashIndex<Key, ListT, Compare, Hash>::
+lower_bound(const Key& key) const {
+  sort();
+  auto it = std::lower_bound(order_.begin(), order_.end(), key,
+    [&](const Handle& h, const Key& k) {return compare_(h->key(), k);});
+  if(it == order_.end()) {return end();}
+  return iterator(this, &*it);
+}
+
+template<class Key, class ListT, class Compare, class Hash>
+typename HashIndex<Key, ListT, Compare, Hash>::
+iterator
+HashIndex<Key, ListT, Compare, Hash>::
+upper_bound(const Key& key) const {
+  sort();
+  auto it = std::upper_bound(order_.begin(), order_.end(), key,
+    [&](const Key& k, const Handle& h) {return compare_(k, h->key());});
+  if(it == order_.end()) {return end();}
+  return iterator(this, &*it);
+}
+
+template<class Key, class ListT, class Compare, class Hash>
+std::pair<typename HashIndex<Key, ListT, Compare, Hash>::iterator, bool>
+HashIndex<Key, ListT, Compare, Hash>::
+insert(const Key& key, const Handle& h) {
+  /* load factor stays at most 3/4 */
+  if(4*(size_ + 1) > 3*slots_.size()) {
+    rehash(std::max<std::size_t>(16, 2*slots_.size()));
+  }
+  std::size_t i = probe(key);
+  if(slots_[i].used_) {
+    return std::make_pair(iterator(this, &slots_[i].h_), false);
+  }
+  slots_[i].key_ = key;
+  slots_[i].h_ = h;
+  slots_[i].used_ = true;
+  size_++;
+  sorted_ = false;
+  return std::make_pair(iterator(this, &slots_[i].h_), true);
+}
+
+template<class Key, class ListT, class Compare, class Hash>
+void
+HashIndex<Key, ListT, Compare, Hash>::
+insert_sorted(const std::vector<std::pair<Key,Handle>>& items) {
+  /* grows once for the whole batch */
+  std::size_t capacity = std::max<std::size_t>(16, slots_.size());
+  while(4*(size_ + items.size()) > 3*capacity) {capacity *= 2;}
+  if(capacity > slots_.size()) {rehash(capacity);}
+  for(auto& item : items) {insert(item.first, item.second);}
+}
+
+template<class Key, class ListT, class Compare, class Hash>
+typename HashIndex<Key, ListT, Compare, Hash>::
+iterator
+HashIndex<Key, ListT, Compare, Hash>::
+erase(iterator it) {
+  std::size_t i = probe((*it)->key());
+  slots_[i].used_ = false;
+  /* shift back every entry that can no longer be reached from its bucket */
+  for(std::size_t j = (i + 1) & mask_; slots_[j].used_; j = (j + 1) & mask_) {
+    std::size_t home = bucket(slots_[j].key_);
+    if(((j - home) & mask_) >= ((j - i) & mask_)) {
+      slots_[i] = slots_[j];
+      slots_[j].used_ = false;
+      i = j;
+    }
+  }
+  size_--;
+  sorted_ = false;
+  return end();
+}
+
+template<class Key, class ListT, class Compare, class Hash>
+void
+HashIndex<Key, ListT, Compare, Hash>::
+clear() {
+  std::vector<Slot>().swap(slots_);
+  std::vector<Handle>().swap(order_);
+  size_ = 0;
+  mask_ = 0;
+  shift_ = 64;
+  sorted_ = true;
+}
+
+/*
+endend
+*/
+
+#endif
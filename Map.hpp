@@ -30,12 +30,27 @@ The rationale for the trailing underscore and the global/static prefixes is that
 #include <random>
 #include <iomanip>
 #include <sstream>
+#include <span>
+#include <tuple>
+#include <vector>
+#include "SlabAllocator.hpp"
+#include "SetIndex.hpp"
+#include "BTreeIndex.hpp"
+#include "HashIndex.hpp"
 /* //////////////////////////////////////////////////////////////
 Class Definition
+
+The const methods keep no scratch state, so any number of threads may
+look up and iterate one Map at the same time while no thread writes.
+edits() grows with every call that may change an entry, those handing
+out a mutable iterator included, so a cache built from the entries is
+current while it stays the same; a write through an iterator kept from
+before the last such call is not counted.
 */ //////////////////////////////////////////////////////////////
 #ifndef MAP_HPP
 #define MAP_HPP
-template<class Key, class Val, class Compare = std::less<Key>>
+template<class Key, class Val, class Compare = std::less<Key>,
+  template<class, class, class> class Index = SetIndex, class... Orders>
 class Map {
  public:
   typedef uint64_t Clr;
@@ -47,30 +62,45 @@ class Map {
   */ //////////////////////////////////////////////////////////////
   class T {
    public:
-    T() {}
-    T(const Key& key) {key_ = key;}
-    T(const Key& key, const Val& val, const Clr& clr)
-      {key_ = key; val_ = val; clr_ = clr;}
+    T() : key_(), clr_(0) {}
+    T(const Key& key) : key_(key), clr_(0) {}
+    T(const Key& key, const Val& val, const Clr& clr) :
+      key_(key), val_(val), clr_(clr) {}
+    template<class... Args>
+    T(std::in_place_t, const Key& key, const Clr& clr, Args&&... args) :
+      key_(key), val_(std::forward<Args>(args)...), clr_(clr) {}
+    const Key& key() const {return key_;}
    private:
     friend class Map;
     Key key_; Val val_; Clr clr_;
   };
-  typedef std::list<T> ListT;
+  typedef std::list<T, SlabAllocator<T>> ListT;
   typedef ListT::iterator IterListT;
   typedef ListT::const_iterator ConstIterListT;
 
   /* //////////////////////////////////////////////////////////////
-  Set of List Iterators
+  Index of List Iterators, see SetIndex.hpp, BTreeIndex.hpp, HashIndex.hpp
+  */ //////////////////////////////////////////////////////////////
+  typedef Index<Key, ListT, Compare> IndexT;
+  typedef IndexT::iterator IterSetT;
+  /* //////////////////////////////////////////////////////////////
+  Secondary Orders, one B+-tree per comparator in Orders over the same
+  nodes, with ties broken by Compare; stale entries stay in them as in
+  the index, parked ones do not
   */ //////////////////////////////////////////////////////////////
-  struct LessIter {
+  template<class Order>
+  struct ThenCompare {
+    Order order_ = Order();
     Compare compare_ = Compare();
-    bool operator() (const IterListT& lhs, const IterListT& rhs) const {
-      return compare_(lhs->key_, rhs->key_);
+    bool operator() (const Key& lhs, const Key& rhs) const {
+      if(order_(lhs, rhs)) {return true;}
+      if(order_(rhs, lhs)) {return false;}
+      return compare_(lhs, rhs);
     }
   };
-  typedef std::set<IterListT,LessIter> SetT;
-  typedef SetT::iterator IterSetT;
-  typedef std::pair<IterSetT,bool> IterBoolSetT;
+  typedef std::tuple<BTreeIndex<Key, ListT, ThenCompare<Orders>>...> OrdersT;
+  template<std::size_t I>
+  using OrderT = std::tuple_element_t<I, OrdersT>;
   /* //////////////////////////////////////////////////////////////
   Iterator Class Definition
   */ //////////////////////////////////////////////////////////////
@@ -85,7 +115,7 @@ class Map {
       std::enable_if_t<std::is_same<IterType_, IterListT>::value, void>
       setKey(const Key& key) {(*qt_.t_).key_ = key;}
     template<class IterType_ = IterType>
-      std::enable_if_t<std::is_same<IterType_, IterSetT>::value, void>
+      std::enable_if_t<!std::is_same<IterType_, IterListT>::value, void>
       setKey(const Key& key) {(**qt_.t_).key_ = key;}
     /* //////////////////////////////////////////////////////////////
     Set Clr
@@ -94,7 +124,7 @@ class Map {
       std::enable_if_t<std::is_same<IterType_, IterListT>::value, void>
       setClr(const Clr& clr) {(*(qt_.t_)).clr_ = clr;}
     template<class IterType_ = IterType>
-      std::enable_if_t<std::is_same<IterType_, IterSetT>::value, void>
+      std::enable_if_t<!std::is_same<IterType_, IterListT>::value, void>
       setClr(const Clr& clr) {(**(qt_.t_)).clr_ = clr;}
     /* //////////////////////////////////////////////////////////////
     Iter Class Internal get/set
@@ -118,7 +148,7 @@ class Map {
         std::enable_if_t<std::is_same<IterType__, IterListT>::value, Key>
         key() const {return (*t_).key_;}
       template<class IterType__ = IterType_>
-        std::enable_if_t<std::is_same<IterType__, IterSetT>::value, Key>
+        std::enable_if_t<!std::is_same<IterType__, IterListT>::value, Key>
         key() const {return (**t_).key_;}
       /* //////////////////////////////////////////////////////////////
       Clr Read-Only
@@ -127,7 +157,7 @@ class Map {
         std::enable_if_t<std::is_same<IterType__, IterListT>::value, Clr>
         clr() const {return (*t_).clr_;}
       template<class IterType__ = IterType_>
-        std::enable_if_t<std::is_same<IterType__, IterSetT>::value, Clr>
+        std::enable_if_t<!std::is_same<IterType__, IterListT>::value, Clr>
         clr() const {return (**t_).clr_;}
       /* //////////////////////////////////////////////////////////////
       Val Read-Only
@@ -137,7 +167,7 @@ class Map {
         && IsConst__, Val>
         val() const {return (*t_).val_;}
       template<class IterType__ = IterType_, bool IsConst__ = IsConst_>
-        std::enable_if_t<std::is_same<IterType__, IterSetT>::value
+        std::enable_if_t<!std::is_same<IterType__, IterListT>::value
         && IsConst__, Val>
         val() const {return (**t_).val_;}
       /* //////////////////////////////////////////////////////////////
@@ -148,7 +178,7 @@ class Map {
         && !IsConst__, Val&>
         val() {return (*t_).val_;}
       template<class IterType__ = IterType_, bool IsConst__ = IsConst_>
-        std::enable_if_t<std::is_same<IterType__, IterSetT>::value
+        std::enable_if_t<!std::is_same<IterType__, IterListT>::value
         && !IsConst__, Val&>
         val() {return (**t_).val_;}
     };
@@ -181,13 +211,8 @@ class Map {
     */ //////////////////////////////////////////////////////////////
     Iterator(const Iterator&) = default;
     Iterator() {}
-    template<class IterType_ = IterType, class = 
-      std::enable_if_t<std::is_same<IterType_, IterListT>::value>>
-    Iterator(const IterListT& it) {qt_.t_ = it;}
+    Iterator(const IterType& it) {qt_.t_ = it;}
     //Iterator(const ConstIterListT& it) {it_ = it;}
-    template<class IterType_ = IterType, class = 
-      std::enable_if_t<std::is_same<IterType_, IterSetT>::value>>
-    Iterator(const IterSetT& it) {qt_.t_ = it;}
     template<bool IsConst_ = IsConst, class = std::enable_if_t<IsConst_>>
     Iterator(const Iterator<IterType, false>& rhs)
       {qt_.t_ = rhs.getIt(); is_valid_ = rhs.is_valid_;}
@@ -231,6 +256,10 @@ class Map {
   using ConstListIterator = Iterator<IterListT,true>;
   using MapIterator =       Iterator<IterSetT,false>;
   using ConstMapIterator =  Iterator<IterSetT,true>;
+  template<std::size_t I>
+  using OrderIterator =      Iterator<typename OrderT<I>::iterator,false>;
+  template<std::size_t I>
+  using ConstOrderIterator = Iterator<typename OrderT<I>::iterator,true>;
   /* //////////////////////////////////////////////////////////////
   Check if Constant Iterators are valid
   */ //////////////////////////////////////////////////////////////
@@ -248,13 +277,21 @@ class Map {
   Clr getClrMax() const;
   Clr getClr() const;
   void setClrMax(const Clr& x);
+  double getTrimFactor() const {return trim_factor_;}
+  void setTrimFactor(double x) {trim_factor_ = x;}
   void clear();
   void hard_clear();
+  std::size_t countLive() const;
+  std::size_t capacity() const {return list_.size() - 1;}
+  std::size_t shrink_to(std::size_t n);
+  uint64_t edits() const {return edits_;}
   /* //////////////////////////////////////////////////////////////
   Implicit Methods Definitions with Iterators
   */ //////////////////////////////////////////////////////////////
   std::string to_string() const;
   MapIterator map_find(const Key& key);
+  MapIterator map_find_hint(const Key& key, MapIterator hint);
+  ConstMapIterator map_cfind(const Key& key) const;
   void move2Front(MapIterator& it);
   void move2Front(ListIterator& it);
   MapIterator rawInsert(const Key& key, const Val& val);
@@ -273,23 +310,92 @@ class Map {
   ConstListIterator list_cend() const; 
   ListIterator list_begin();
   ListIterator list_end();
-  MapIterator try_emplace(const Key& key, const Val& val);
+  template<class... Args>
+  MapIterator emplace(const Key& key, Args&&... args);
+  MapIterator try_emplace(const Key& key, const Val& val)
+    {return emplace(key, val);}
+  MapIterator try_emplace(const Key& key, Val&& val)
+    {return emplace(key, std::move(val));}
+  template<class... Args>
+  MapIterator emplace_hint(MapIterator hint, const Key& key, Args&&... args);
+  MapIterator try_emplace_hint(MapIterator hint, const Key& key,
+    const Val& val) {return emplace_hint(hint, key, val);}
+  MapIterator try_emplace_hint(MapIterator hint, const Key& key, Val&& val)
+    {return emplace_hint(hint, key, std::move(val));}
+  std::size_t try_emplace_range(std::span<const std::pair<Key,Val>> items);
+  template<class ValT, class Combine>
+  MapIterator upsert(const Key& key, ValT&& val, Combine combine);
+  template<class Combine>
+  std::size_t merge(const Map& other, Combine combine);
+  template<class Combine, class Convert>
+  std::size_t merge(const Map& other, Combine combine, Convert convert);
+  MapIterator erase(MapIterator itm);
+  /* //////////////////////////////////////////////////////////////
+  Secondary Orders, I-th comparator of Orders
+  */ //////////////////////////////////////////////////////////////
+  template<std::size_t I>
+  OrderIterator<I> order_begin()
+    {edits_++; return OrderIterator<I>(std::get<I>(orders_).begin());}
+  template<std::size_t I>
+  OrderIterator<I> order_end()
+    {edits_++; return OrderIterator<I>(std::get<I>(orders_).end());}
+  template<std::size_t I>
+  OrderIterator<I> order_lower_bound(const Key& key)
+    {edits_++; return OrderIterator<I>(std::get<I>(orders_).lower_bound(key));}
+  template<std::size_t I>
+  OrderIterator<I> order_upper_bound(const Key& key)
+    {edits_++; return OrderIterator<I>(std::get<I>(orders_).upper_bound(key));}
+  template<std::size_t I>
+  ConstOrderIterator<I> order_cbegin() const
+    {return ConstOrderIterator<I>(std::get<I>(orders_).begin());}
+  template<std::size_t I>
+  ConstOrderIterator<I> order_cend() const
+    {return ConstOrderIterator<I>(std::get<I>(orders_).end());}
+  template<class Pred>
+  std::size_t erase_if(Pred pred);
   void sort_list();
  private:
+  void ordersInsert(const Key& key, IterListT itl);
+  void ordersErase(const Key& key);
+  void ordersInsertSorted(const std::vector<std::pair<Key,IterListT>>& items);
+  template<std::size_t I>
+  void orderInsertSorted(const std::vector<std::pair<Key,IterListT>>& items);
+  void ordersClear();
+  static constexpr int c_seek = 8; // steps from a hint before a full search
+  IterSetT seek(const Key& key, IterSetT its) const;
+  void park(IterListT itl);
+  void touch(IterListT itl);
+  template<class... Args>
+  IterListT newNode(const Key& key, Args&&... args);
+  template<class... Args>
+  MapIterator place(IterSetT its, bool found, const Key& key,
+    Args&&... args);
   /* //////////////////////////////////////////////////////////////
   Private Variables without using Iterator Class
   */ //////////////////////////////////////////////////////////////
   Clr clr_ = 1;
   Clr clr_max_ = UINT64_MAX;
-  SetT set_; 
-  mutable ListT list_ = {T()};
-    /* "list_" is made mutable to prevent const_iterator from spawning */
-  mutable ListT list_temp_ = {T()};
+  uint64_t edits_ = 0; // see edits()
+  double trim_factor_ = 0;
+    /* when positive, clear() keeps at most trim_factor_ times as many
+    entries as were live */
+  Compare compare_ = Compare();
+  IndexT set_; 
+  OrdersT orders_;
+  mutable ListT list_;
+    /* "list_" is made mutable to prevent const_iterator from spawning,
+    its sentinel is pushed by hard_clear() */
+  std::size_t parked_ = 0;
+    /* erased nodes, out of the index and last in the list, behind the
+    stale entries, where the next inserts take them from */
+  std::vector<IterListT> touched_;
+  bool unsorted_ = false;
+    /* the live part of the list is in key order but for the touched_
+    nodes, which lead it; in no known order when unsorted_ */
   /* //////////////////////////////////////////////////////////////
   Private Variable using Iterator Class
   */ //////////////////////////////////////////////////////////////
   ListIterator list_begin_;
-  mutable ListIterator list_temp_it_ = ListIterator(list_temp_.begin());
   ListIterator itl_;
   MapIterator itm_;
   ConstListIterator citl_;
@@ -300,30 +406,89 @@ class Map {
 Explicit Methods without Iterators
 */ //////////////////////////////////////////////////////////////
 
-template<class Key, class Val, class Compare>
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
 void
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 sort_list() {
-  auto itm = map_end();
-  while(true) {
-    itm--;
-    //std::cout << itm->key().to_string() << std::endl;
-    if(itm->clr() == clr_) {move2Front(itm);}
-    if(itm == map_begin()) {break;}
+  /* puts the live entries in key order.  Free when nothing moved since
+  the last sort, else the touched nodes are sorted and merged into the
+  rest, which is still in order */
+  if(unsorted_) {
+    touched_.clear();
+    unsorted_ = false;
+    if(set_.empty()) {return;}
+    auto its = set_.end();
+    do {
+      its--;
+      auto itl = *its;
+      if(itl->clr_ == clr_) {
+        list_.splice(list_begin_.It(), list_, itl);
+        list_begin_.It() = itl;
+      }
+    } while(its != set_.begin());
+    return;
+  }
+  if(touched_.empty()) {return;}
+  std::vector<IterListT> moved;
+  for(auto itl : touched_) {
+    if(itl->clr_ == clr_) {moved.push_back(itl);}
+  }
+  touched_.clear();
+  std::sort(moved.begin(), moved.end(),
+    [&](const IterListT& a, const IterListT& b)
+    {return compare_(a->key_, b->key_);});
+  moved.erase(std::unique(moved.begin(), moved.end()), moved.end());
+  /* the moved nodes lead the live list */
+  auto rest = std::next(list_begin_.It(), moved.size());
+  if(IndexT::c_ordered
+    && moved.size()*std::log2(double(set_.size()) + 1) < set_.size()) {
+    /* few moved: each goes right before its live successor in the
+    index, largest first, while the others look stale */
+    for(auto itl : moved) {itl->clr_ = clr_ - 1;}
+    for(std::size_t i = moved.size(); i-- > 0;) {
+      auto itl = moved[i];
+      auto its = set_.upper_bound(itl->key_);
+      while(its != set_.end() && (*its)->clr_ != clr_) {its++;}
+      if(its != set_.end()) {
+        list_.splice(*its, list_, itl);
+      } else {
+        /* the largest live key goes after the last untouched node */
+        while(its != set_.begin() && (*std::prev(its))->clr_ != clr_) {its--;}
+        list_.splice(its == set_.begin() ? rest : std::next(*std::prev(its)),
+          list_, itl);
+      }
+      itl->clr_ = clr_;
+    }
+    list_begin_.It() = std::next(list_.begin());
+    return;
+  }
+  for(auto itl : moved) {
+    while(rest != list_.end() && rest->clr_ == clr_
+      && compare_(rest->key_, itl->key_)) {
+      rest++;
+    }
+    list_.splice(rest, list_, itl);
   }
+  list_begin_.It() = std::next(list_.begin());
 }
 
-template<class Key, class Val, class Compare>
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
 void
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 setClr(const Clr& clr) {
+  edits_++;
   clr_ = clr;
+  unsorted_ = true;
 }
 
-template<class Key, class Val, class Compare>
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
 void
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 flatten_clear() {
+  edits_++;
   auto it = list_.begin();
   while(it != list_.end()) {
     if(it->clr_ != clr_) {
@@ -337,33 +502,39 @@ flatten_clear() {
   list_.begin()->clr_ = clr_;
 }
 
-template<class Key, class Val, class Compare>
-Map<Key, Val, Compare>::
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+Map<Key, Val, Compare, Index, Orders...>::
 Clr
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 getClrMax() const {
   return clr_max_;
 }
 
-template<class Key, class Val, class Compare>
-Map<Key, Val, Compare>::
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+Map<Key, Val, Compare, Index, Orders...>::
 Clr
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 getClr() const {
   return clr_;
 }
 
-template<class Key, class Val, class Compare>
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
 void
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 setClrMax(const Clr& x) {
   clr_max_ = x;
 }
 
-template<class Key, class Val, class Compare>
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
 void
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 clear() {
+  edits_++;
+  std::size_t live = (trim_factor_ > 0) ? countLive() : 0;
   if(clr_ < clr_max_) {
     clr_++;
   } else {
@@ -374,28 +545,105 @@ clear() {
     }
   }
   list_.begin()->clr_ = clr_;
+  touched_.clear();
+  unsorted_ = false;
+  if(trim_factor_ > 0) {shrink_to(std::size_t(trim_factor_*live));}
 }
 
-template<class Key, class Val, class Compare>
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
 void
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 hard_clear() {
+  edits_++;
   clr_ = 1;
   set_.clear();
+  ordersClear();
   list_.clear();
+  parked_ = 0;
+  touched_.clear();
+  unsorted_ = false;
   list_.push_front(T());
   list_.begin()->clr_ = clr_;
   list_begin_.It() = list_.end();
 }
 
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+std::size_t
+Map<Key, Val, Compare, Index, Orders...>::
+countLive() const {
+  /* live entries lead the list */
+  std::size_t count = 0;
+  for(auto it = list_cbegin(); it != list_cend() && it->clr() == clr_; it++) {
+    count++;
+  }
+  return count;
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+std::size_t
+Map<Key, Val, Compare, Index, Orders...>::
+shrink_to(std::size_t n) {
+  edits_++;
+  /* releases stale entries from the tail of the list until at most n
+  entries are left, live entries are never released.  Free slabs go
+  back to the system.  When most entries go, the rest are copied to a
+  fresh list, since they would pin a slab each, and the index is
+  rebuilt.  Invalidates all iterators.  Returns the number released */
+  std::size_t count = 0;
+  auto tail = list_.end();
+  while(list_.size() - 1 - count > n && std::prev(tail)->clr_ != clr_) {
+    tail--; count++;
+  }
+  if(count == 0) {return 0;}
+  /* parked nodes go first, they are the last of the list */
+  std::size_t parked = std::min(count, parked_);
+  parked_ -= parked;
+  if(2*count < list_.size()) {
+    /* live nodes stay, so only parked ones leave touched_ */
+    touched_.erase(std::remove_if(touched_.begin(), touched_.end(),
+      [&](const IterListT& itl) {return itl->clr_ != clr_;}), touched_.end());
+    auto itl = tail;
+    for(std::size_t i = parked; i < count; i++, itl++) {
+      set_.erase(set_.find(itl->key_));
+      ordersErase(itl->key_);
+    }
+    list_.erase(tail, list_.end());
+    list_.get_allocator().arena().trim();
+    return count;
+  }
+  ListT fresh(list_.begin(), tail);
+  list_.swap(fresh);
+  fresh.clear();
+  /* the copy keeps the order, not the touched handles */
+  unsorted_ = unsorted_ || !touched_.empty();
+  touched_.clear();
+  std::vector<std::pair<Key,IterListT>> items;
+  auto last = std::prev(list_.end(), parked_);
+  for(auto itl = std::next(list_.begin()); itl != last; itl++) {
+    items.emplace_back(itl->key_, itl);
+  }
+  std::sort(items.begin(), items.end(),
+    [&](const std::pair<Key,IterListT>& a, const std::pair<Key,IterListT>& b)
+    {return compare_(a.first, b.first);});
+  set_.clear();
+  set_.insert_sorted(items);
+  ordersClear();
+  ordersInsertSorted(items);
+  list_begin_.It() = std::next(list_.begin());
+  return count;
+}
 
 /* //////////////////////////////////////////////////////////////
 Explicit Methods with Iterators
 */ //////////////////////////////////////////////////////////////
 
-template<class Key, class Val, class Compare>
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
 std::string
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 to_string() const {
   auto citm = map_cbegin();
   auto citl = ConstListIterator(list_.begin());
@@ -415,7 +663,7 @@ to_string() const {
   tmp += "list_.size()=" + std::to_string(list_.size());
   tmp += "\n";
   citl++;
-  while (citm != map_cend() && citl_ != list_cend()) {
+  while (citm != map_cend() && citl != list_cend()) {
     tmp += (*citm).key().to_string() + " ";
     tmp += citm->val().to_string() + " ";
     tmp += std::to_string((*citm).clr()) + " | ";
@@ -427,221 +675,696 @@ to_string() const {
   return tmp;
 }
 
-template<class Key, class Val, class Compare>
-Map<Key, Val, Compare>::
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+Map<Key, Val, Compare, Index, Orders...>::
 MapIterator
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 map_find(const Key& key) {
-  list_temp_it_.setKey(key);
-  itm_ = MapIterator(set_.find(list_temp_it_.It()));
-  return itm_;
+  edits_++;
+  return MapIterator(set_.find(key));
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+Map<Key, Val, Compare, Index, Orders...>::
+MapIterator
+Map<Key, Val, Compare, Index, Orders...>::
+map_find_hint(const Key& key, MapIterator hint) {
+  edits_++;
+  /* map_find searched from hint, an iterator of this map such as the
+  previous result; cheap when key is near hint */
+  auto its = seek(key, hint.getIt());
+  if(its != set_.end() && !compare_(key, (*its)->key_)) {
+    return MapIterator(its);
+  }
+  return map_end();
 }
 
-template<class Key, class Val, class Compare>
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+Map<Key, Val, Compare, Index, Orders...>::
+IterSetT
+Map<Key, Val, Compare, Index, Orders...>::
+seek(const Key& key, IterSetT its) const {
+  /* lower_bound(key) found by stepping from its toward key, with a
+  search from the root after c_seek steps; a hashed index finds key */
+  if constexpr(!IndexT::c_ordered) {
+    return set_.find(key);
+  } else {
+    if(its == set_.end() || !compare_((*its)->key_, key)) {
+      for(int i = 0; i < c_seek; i++) {
+        if(its == set_.begin() || compare_((*std::prev(its))->key_, key)) {
+          return its;
+        }
+        its--;
+      }
+    } else {
+      for(int i = 0; i < c_seek; i++) {
+        its++;
+        if(its == set_.end() || !compare_((*its)->key_, key)) {return its;}
+      }
+    }
+    return set_.lower_bound(key);
+  }
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+Map<Key, Val, Compare, Index, Orders...>::
+ConstMapIterator
+Map<Key, Val, Compare, Index, Orders...>::
+map_cfind(const Key& key) const {
+  return ConstMapIterator(set_.find(key));
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
 void
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 move2Front(MapIterator& itm) {
+  edits_++;
   list_.splice(list_begin_.It(), list_, *(itm.It()));
   list_begin_ = *(itm.It());
+  touch(*(itm.It()));
 }
 
-template<class Key, class Val, class Compare>
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
 void
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 move2Front(ListIterator& itl) {
+  edits_++;
   list_.splice(list_begin_.It(), list_, (itl.It()));
   list_begin_ = itl;
+  touch(itl.It());
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+void
+Map<Key, Val, Compare, Index, Orders...>::
+touch(IterListT itl) {
+  /* records a node moved to the front for sort_list, which sorts the
+  whole list instead once most nodes moved */
+  if(unsorted_) {return;}
+  if(touched_.size() >= list_.size()) {
+    touched_.clear();
+    unsorted_ = true;
+    return;
+  }
+  touched_.push_back(itl);
 }
 
-template<class Key, class Val, class Compare>
-Map<Key, Val, Compare>::
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+Map<Key, Val, Compare, Index, Orders...>::
 MapIterator
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 rawInsert(const Key& key, const Val& val) {
-  list_.push_front(T());
-  list_.begin()->clr_ = clr_;
-  auto itl = list_.begin(); ++itl;
-  itl->val_ = val;
-  itl->key_ = key;
-  itl->clr_ = clr_;
-  set_.insert(itl);
-  itm_ = map_find(key);
-  list_begin_ = ListIterator(itl);
+  edits_++;
+  auto itl = newNode(key, val);
+  auto inserted = set_.insert(key, itl);
+  if(inserted.second) {ordersInsert(key, itl);}
+  itm_ = MapIterator(inserted.first);
   return itm_;
 }
 
-template<class Key, class Val, class Compare>
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+template<class... Args>
+Map<Key, Val, Compare, Index, Orders...>::
+IterListT
+Map<Key, Val, Compare, Index, Orders...>::
+newNode(const Key& key, Args&&... args) {
+  /* the value is built from args inside the node, right after the
+  sentinel; the node is not indexed */
+  auto itl = list_.emplace(std::next(list_.begin()), std::in_place, key, clr_,
+    std::forward<Args>(args)...);
+  list_begin_ = ListIterator(itl);
+  touch(itl);
+  return itl;
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
 void
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 reInsertKey(MapIterator& it, const Key& key) {
-  auto nh = set_.extract(it.It());
-  (*nh.value()).key_ = key;
-  set_.insert(std::move(nh));
-  it = map_find(key);
+  edits_++;
+  auto h = *(it.It());
+  set_.erase(it.It());
+  ordersErase(h->key_);
+  h->key_ = key;
+  it = MapIterator(set_.insert(key, h).first);
+  ordersInsert(key, h);
   it.setClr(clr_);
+  unsorted_ = true;
 }
 
-template<class Key, class Val, class Compare>
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
 void
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 reInsertKey(MapIterator& it0, const Key& key0,
   MapIterator& it1, const Key& key1) {
-  auto nh0 = set_.extract(it0.It());
-  auto nh1 = set_.extract(it1.It());
-  (*nh0.value()).key_ = key0;
-  (*nh1.value()).key_ = key1;
-  set_.insert(std::move(nh0));
-  set_.insert(std::move(nh1));
+  edits_++;
+  /* erasing may move other entries of the index, so it1 is looked up
+  again through its (still unchanged) key */
+  auto h0 = *(it0.It());
+  auto h1 = *(it1.It());
+  set_.erase(it0.It());
+  set_.erase(set_.find(h1->key_));
+  ordersErase(h0->key_);
+  ordersErase(h1->key_);
+  h0->key_ = key0;
+  h1->key_ = key1;
+  set_.insert(key0, h0);
+  set_.insert(key1, h1);
+  ordersInsert(key0, h0);
+  ordersInsert(key1, h1);
   it0 = map_find(key0);
   it1 = map_find(key1);
   it0.setClr(clr_);
   it1.setClr(clr_);
+  unsorted_ = true;
 }
 
-template<class Key, class Val, class Compare>
-Map<Key, Val, Compare>::
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+Map<Key, Val, Compare, Index, Orders...>::
 MapIterator
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 map_lower_bound(const Key& key) {
-  list_temp_it_ = list_temp_.begin();
-  (*list_temp_it_).it_.key_ = key;
-  return MapIterator(set_.lower_bound(list_temp_it_));
+  edits_++;
+  return MapIterator(set_.lower_bound(key));
 }
 
-template<class Key, class Val, class Compare>
-Map<Key, Val, Compare>::
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+Map<Key, Val, Compare, Index, Orders...>::
 MapIterator
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 map_upper_bound(const Key& key) {
-  list_temp_it_ = list_temp_.begin();
-  (*list_temp_it_).key_ = key;
-  return MapIterator(set_.upper_bound(list_temp_it_));
+  edits_++;
+  return MapIterator(set_.upper_bound(key));
 }
 
-template<class Key, class Val, class Compare>
-Map<Key, Val, Compare>::
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+Map<Key, Val, Compare, Index, Orders...>::
 ConstMapIterator
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 map_clower_bound (const Key& key) const {
-  list_temp_it_ = list_temp_.begin();
-  (*list_temp_it_).key_ = key;
-  return ConstMapIterator(set_.lower_bound(list_temp_it_));
+  return ConstMapIterator(set_.lower_bound(key));
 }
 
-template<class Key, class Val, class Compare>
-Map<Key, Val, Compare>::
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+Map<Key, Val, Compare, Index, Orders...>::
 ConstMapIterator
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 map_cupper_bound (const Key& key) const {
-  list_temp_it_ = list_temp_.begin();
-  (*list_temp_it_).key_ = key;
-  return ConstMapIterator(set_.upper_bound(list_temp_it_));
+  return ConstMapIterator(set_.upper_bound(key));
 }
 
-template<class Key, class Val, class Compare>
-Map<Key, Val, Compare>::
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+Map<Key, Val, Compare, Index, Orders...>::
 ConstMapIterator
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 map_cbegin() const {
   return ConstMapIterator(set_.begin());
 }
 
-template<class Key, class Val, class Compare>
-Map<Key, Val, Compare>::
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+Map<Key, Val, Compare, Index, Orders...>::
 ConstMapIterator
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 map_cend() const {
   return ConstMapIterator(set_.end());
 }
 
-template<class Key, class Val, class Compare>
-Map<Key, Val, Compare>::
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+Map<Key, Val, Compare, Index, Orders...>::
 MapIterator
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 map_begin() {
+  edits_++;
   return MapIterator(set_.begin());
 }
 
-template<class Key, class Val, class Compare>
-Map<Key, Val, Compare>::
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+Map<Key, Val, Compare, Index, Orders...>::
 MapIterator
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 map_end() {
+  edits_++;
   return MapIterator(set_.end());
 }
 
-template<class Key, class Val, class Compare>
-Map<Key, Val, Compare>::
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+Map<Key, Val, Compare, Index, Orders...>::
 ConstListIterator
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 list_cbegin() const {
   return ConstListIterator(list_begin_);
 }
 
-template<class Key, class Val, class Compare>
-Map<Key, Val, Compare>::
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+Map<Key, Val, Compare, Index, Orders...>::
 ConstListIterator
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 list_cend() const {
   return ConstListIterator(list_.end());
 }
 
 
-template<class Key, class Val, class Compare>
-Map<Key, Val, Compare>::
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+Map<Key, Val, Compare, Index, Orders...>::
 ListIterator
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 list_begin() {
+  edits_++;
   return ListIterator(list_begin_);
 }
 
-template<class Key, class Val, class Compare>
-Map<Key, Val, Compare>::
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+Map<Key, Val, Compare, Index, Orders...>::
 ListIterator
-Map<Key, Val, Compare>::
+Map<Key, Val, Compare, Index, Orders...>::
 list_end() {
+  edits_++;
   return ListIterator(list_.end());
 }
 
-template<class Key, class Val, class Compare>
-Map<Key, Val, Compare>::
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+template<class... Args>
+Map<Key, Val, Compare, Index, Orders...>::
 MapIterator
-Map<Key, Val, Compare>::
-try_emplace(const Key& key, const Val& val) {
-  //std::cout << to_string() << std::endl;
-  itm_ = map_find(key);
-  if (itm_ != map_end()) {
-    //std::cout << "key exists" << std::endl;
-    if (itm_->clr() != clr_) {
-      //std::cout << "key is cleared" << std::endl;
-      itm_.setClr(clr_);
-      itm_->val() = val;
-      move2Front(itm_);
-      itm_.is_valid_ = true;
+Map<Key, Val, Compare, Index, Orders...>::
+emplace(const Key& key, Args&&... args) {
+  edits_++;
+  /* try_emplace with the value built from args, which are left alone
+  when key is live; the returned iterator is valid when emplaced */
+  auto its = IndexT::c_ordered ? set_.lower_bound(key) : set_.find(key);
+  bool found = its != set_.end() && !compare_(key, (*its)->key_);
+  if(found && (*its)->clr_ == clr_) {
+    MapIterator itm(its);
+    itm.is_valid_ = false;
+    return itm;
+  }
+  return place(its, found, key, std::forward<Args>(args)...);
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+template<class... Args>
+Map<Key, Val, Compare, Index, Orders...>::
+MapIterator
+Map<Key, Val, Compare, Index, Orders...>::
+emplace_hint(MapIterator hint, const Key& key, Args&&... args) {
+  edits_++;
+  /* emplace searched from hint, an iterator of this map such as the
+  previous result, so a sorted stream costs amortized O(1) per key
+  with an ordered index */
+  auto its = seek(key, hint.getIt());
+  bool found = its != set_.end() && !compare_(key, (*its)->key_);
+  if(found && (*its)->clr_ == clr_) {
+    MapIterator itm(its);
+    itm.is_valid_ = false;
+    return itm;
+  }
+  return place(its, found, key, std::forward<Args>(args)...);
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+template<class... Args>
+Map<Key, Val, Compare, Index, Orders...>::
+MapIterator
+Map<Key, Val, Compare, Index, Orders...>::
+place(IterSetT its, bool found, const Key& key, Args&&... args) {
+  /* emplaces key, which is stale at its when found, else missing with
+  its as the insert hint: revives the stale entry, else reuses the stale
+  node at the tail of the list, else builds a new node */
+  MapIterator itm;
+  if(found) {
+    auto itl = *its;
+    itm = MapIterator(its);
+    itl->clr_ = clr_;
+    itl->val_ = Val(std::forward<Args>(args)...);
+    itl_ = ListIterator(itl);
+    move2Front(itl_);
+  } else {
+    /* the sentinel leads the list, and is never reused even when
+    setClr() left it looking stale */
+    auto itl = std::prev(list_.end());
+    if(itl != list_.begin() && itl->clr_ != clr_) {
+      /* a parked node is not indexed, while erasing the old key of a
+      stale node voids the hint unless the index is stable */
+      bool hinted = parked_ > 0 || IndexT::c_stable;
+      if(parked_ > 0) {
+        parked_--;
+      } else {
+        auto old = set_.find(itl->key_);
+        if(old == its) {its = set_.erase(old);} else {set_.erase(old);}
+        ordersErase(itl->key_);
+      }
+      itl->key_ = key;
+      itl->val_ = Val(std::forward<Args>(args)...);
+      itl->clr_ = clr_;
+      itl_ = ListIterator(itl);
+      move2Front(itl_);
+      itm = hinted ? MapIterator(set_.insert(its, key, itl))
+        : MapIterator(set_.insert(key, itl).first);
     } else {
-      //std::cout << "key is not cleared" << std::endl;
-      itm_.is_valid_ = false;
+      itl = newNode(key, std::forward<Args>(args)...);
+      itm = MapIterator(set_.insert(its, key, itl));
     }
-  } else {
-    //std::cout << "key does not exist" << std::endl;
-    itl_.It() = list_.end(); itl_--;
-    if (itl_->clr() != clr_) {
-      //std::cout << "a key is reusable" << std::endl;
+    ordersInsert(key, itl);
+  }
+  itm.is_valid_ = true;
+  return itm;
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+template<class ValT, class Combine>
+Map<Key, Val, Compare, Index, Orders...>::
+MapIterator
+Map<Key, Val, Compare, Index, Orders...>::
+upsert(const Key& key, ValT&& val, Combine combine) {
+  edits_++;
+  /* combine(stored, val) into a live entry, else emplace val like
+  try_emplace; the returned iterator is valid when val was emplaced.
+  An ordered index is searched once with lower_bound, which is also the
+  hint of the insert */
+  auto its = IndexT::c_ordered ? set_.lower_bound(key) : set_.find(key);
+  bool found = its != set_.end() && !compare_(key, (*its)->key_);
+  if(found && (*its)->clr_ == clr_) {
+    combine((*its)->val_, val);
+    MapIterator itm(its);
+    itm.is_valid_ = false;
+    return itm;
+  }
+  return place(its, found, key, std::forward<ValT>(val));
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+template<class Combine>
+std::size_t
+Map<Key, Val, Compare, Index, Orders...>::
+merge(const Map& other, Combine combine) {
+  edits_++;
+  return merge(other, combine, [](const Val& val) -> const Val& {return val;});
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+template<class Combine, class Convert>
+std::size_t
+Map<Key, Val, Compare, Index, Orders...>::
+merge(const Map& other, Combine combine, Convert convert) {
+  edits_++;
+  /* adds the live entries of other: combine(stored, val) where the key
+  is live, else convert(val) is emplaced; returns the number emplaced.
+  Both indices are walked together when other is dense in this, so the
+  cost is linear in both sizes.  A hashed index, or a few entries, take
+  one lookup per key instead */
+  std::size_t count = 0;
+  if(&other == this) {
+    for(auto itl = list_begin_.It(); itl != list_.end() && itl->clr_ == clr_;
+      itl++) {
+      Val val = itl->val_;
+      combine(itl->val_, val);
+    }
+    return 0;
+  }
+  auto live = [&](const IterListT& itl) {return itl->clr_ == other.clr_;};
+  if(!IndexT::c_ordered
+    || other.set_.size()*std::log2(double(set_.size()) + 1) < set_.size()) {
+    for(auto itl = other.list_begin_.getIt();
+      itl != other.list_.end() && live(itl); itl++) {
+      auto its = IndexT::c_ordered ? set_.lower_bound(itl->key_)
+        : set_.find(itl->key_);
+      bool found = its != set_.end() && !compare_(itl->key_, (*its)->key_);
+      if(found && (*its)->clr_ == clr_) {
+        combine((*its)->val_, itl->val_);
+      } else {
+        place(its, found, itl->key_, convert(itl->val_));
+        count++;
+      }
+    }
+    return count;
+  }
+  /* hits are combined or revived during the walk, misses are kept in
+  key order and take nodes after it, so the walk sees a fixed index */
+  std::vector<IterListT> miss;
+  auto its = set_.begin();
+  for(auto ito = other.set_.begin(); ito != other.set_.end(); ito++) {
+    IterListT src = *ito;
+    if(!live(src)) {continue;}
+    while(its != set_.end() && compare_((*its)->key_, src->key_)) {its++;}
+    if(its == set_.end() || compare_(src->key_, (*its)->key_)) {
+      miss.push_back(src);
+      continue;
+    }
+    auto itl = *its;
+    if(itl->clr_ == clr_) {
+      combine(itl->val_, src->val_);
+    } else {
+      itl->clr_ = clr_;
+      itl->val_ = convert(src->val_);
+      itl_ = ListIterator(itl);
+      move2Front(itl_);
+      count++;
+    }
+  }
+  std::vector<std::pair<Key,IterListT>> fresh;
+  for(std::size_t i = miss.size(); i-- > 0;) {
+    /* the sentinel leads the list, and is never reused even when
+    setClr() left it looking stale */
+    auto itl = std::prev(list_.end());
+    if(itl != list_.begin() && itl->clr_ != clr_) {
+      if(parked_ > 0) {
+        parked_--;
+      } else {
+        set_.erase(set_.find(itl->key_));
+        ordersErase(itl->key_);
+      }
+      itl->key_ = miss[i]->key_;
+      itl->val_ = convert(miss[i]->val_);
+      itl->clr_ = clr_;
+      itl_ = ListIterator(itl);
       move2Front(itl_);
-      itm_ = map_find(itl_->key());
-      reInsertKey(itm_, key);
-      itl_->val() = val;
-      itl_.setClr(clr_);
-      itm_.is_valid_ = true;
     } else {
-      //std::cout << "no key is reusable" << std::endl;
-      itm_ = rawInsert(key, val);
-      itm_.is_valid_ = true;
+      itl = newNode(miss[i]->key_, convert(miss[i]->val_));
     }
+    fresh.emplace_back(miss[i]->key_, itl);
+    count++;
   }
-  return  itm_;
+  std::reverse(fresh.begin(), fresh.end());
+  set_.insert_sorted(fresh);
+  ordersInsertSorted(fresh);
+  return count;
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+void
+Map<Key, Val, Compare, Index, Orders...>::
+ordersInsert(const Key& key, IterListT itl) {
+  std::apply([&](auto&... order) {(order.insert(key, itl), ...);}, orders_);
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+void
+Map<Key, Val, Compare, Index, Orders...>::
+ordersErase(const Key& key) {
+  std::apply([&](auto&... order) {(order.erase(order.find(key)), ...);},
+    orders_);
 }
 
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+void
+Map<Key, Val, Compare, Index, Orders...>::
+ordersInsertSorted(const std::vector<std::pair<Key,IterListT>>& items) {
+  [&]<std::size_t... I>(std::index_sequence<I...>) {
+    (orderInsertSorted<I>(items), ...);
+  }(std::index_sequence_for<Orders...>());
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+template<std::size_t I>
+void
+Map<Key, Val, Compare, Index, Orders...>::
+orderInsertSorted(const std::vector<std::pair<Key,IterListT>>& items) {
+  /* items are sorted by Compare, the order sorts its own copy */
+  ThenCompare<std::tuple_element_t<I, std::tuple<Orders...>>> less;
+  auto sorted = items;
+  std::sort(sorted.begin(), sorted.end(),
+    [&](const std::pair<Key,IterListT>& a, const std::pair<Key,IterListT>& b)
+    {return less(a.first, b.first);});
+  std::get<I>(orders_).insert_sorted(sorted);
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+void
+Map<Key, Val, Compare, Index, Orders...>::
+ordersClear() {
+  std::apply([](auto&... order) {(order.clear(), ...);}, orders_);
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+void
+Map<Key, Val, Compare, Index, Orders...>::
+park(IterListT itl) {
+  /* itl is out of the index; it joins the parked nodes at the tail */
+  itl->clr_ = 0;
+  list_.splice(list_.end(), list_, itl);
+  list_begin_.It() = std::next(list_.begin());
+  parked_++;
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+Map<Key, Val, Compare, Index, Orders...>::
+MapIterator
+Map<Key, Val, Compare, Index, Orders...>::
+erase(MapIterator itm) {
+  edits_++;
+  /* removes the entry of itm, live or stale, from the index and parks
+  its node for the next insert; returns the iterator following itm
+  (map_end() for a hashed index) */
+  auto itl = *(itm.It());
+  MapIterator next(set_.erase(itm.It()));
+  ordersErase(itl->key_);
+  park(itl);
+  return next;
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+template<class Pred>
+std::size_t
+Map<Key, Val, Compare, Index, Orders...>::
+erase_if(Pred pred) {
+  edits_++;
+  /* erases every live entry for which pred(key, val) holds, walking the
+  live part of the list, so k entries cost one lookup each; returns k */
+  std::size_t count = 0;
+  auto itl = list_begin_.It();
+  while(itl != list_.end() && itl->clr_ == clr_) {
+    auto cur = itl++;
+    if(!pred(static_cast<const Key&>(cur->key_), cur->val_)) {continue;}
+    set_.erase(set_.find(cur->key_));
+    ordersErase(cur->key_);
+    park(cur);
+    count++;
+  }
+  return count;
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class... Orders>
+std::size_t
+Map<Key, Val, Compare, Index, Orders...>::
+try_emplace_range(std::span<const std::pair<Key,Val>> items) {
+  edits_++;
+  /* same result as try_emplace on each item in turn, so the first of
+  equal keys wins, but the items are sorted once and matched against the
+  index in one pass; returns the number of entries emplaced.  A hashed
+  index already inserts in O(1), so it takes the items one by one */
+  std::size_t count = 0;
+  if constexpr(!IndexT::c_ordered) {
+    for(auto& item : items) {
+      if(try_emplace(item.first, item.second).is_valid_) {count++;}
+    }
+    return count;
+  }
+  std::vector<std::pair<Key,Val>> batch(items.begin(), items.end());
+  auto less = [&](const std::pair<Key,Val>& a, const std::pair<Key,Val>& b)
+    {return compare_(a.first, b.first);};
+  std::stable_sort(batch.begin(), batch.end(), less);
+  batch.erase(std::unique(batch.begin(), batch.end(),
+    [&](const std::pair<Key,Val>& a, const std::pair<Key,Val>& b)
+    {return !less(a, b) && !less(b, a);}), batch.end());
+  /* match: a merge walk over an ordered index when the batch is dense
+  in it, otherwise one lookup per key */
+  std::vector<IterListT> hit(batch.size(), list_.end());
+  if(IndexT::c_ordered
+    && batch.size()*std::log2(double(set_.size()) + 1) >= set_.size()) {
+    auto its = set_.begin();
+    for(std::size_t i = 0; i < batch.size(); i++) {
+      while(its != set_.end() && compare_((*its)->key_, batch[i].first)) {
+        its++;
+      }
+      if(its != set_.end() && !compare_(batch[i].first, (*its)->key_)) {
+        hit[i] = *its;
+      }
+    }
+  } else {
+    for(std::size_t i = 0; i < batch.size(); i++) {
+      auto its = set_.find(batch[i].first);
+      if(its != set_.end()) {hit[i] = *its;}
+    }
+  }
+  /* revive stale hits first, so the stale tail holds no hit */
+  for(std::size_t i = batch.size(); i-- > 0;) {
+    if(hit[i] != list_.end() && hit[i]->clr_ != clr_) {
+      hit[i]->clr_ = clr_;
+      hit[i]->val_ = std::move(batch[i].second);
+      itl_ = ListIterator(hit[i]);
+      move2Front(itl_);
+      count++;
+    }
+  }
+  /* misses take stale nodes from the tail of the list, then new nodes,
+  and go into the index together */
+  std::vector<std::pair<Key,IterListT>> fresh;
+  for(std::size_t i = batch.size(); i-- > 0;) {
+    if(hit[i] != list_.end()) {continue;}
+    /* the sentinel leads the list, and is never reused even when
+    setClr() left it looking stale */
+    auto itl = std::prev(list_.end());
+    if(itl != list_.begin() && itl->clr_ != clr_) {
+      if(parked_ > 0) {
+        parked_--;
+      } else {
+        set_.erase(set_.find(itl->key_));
+        ordersErase(itl->key_);
+      }
+      itl->key_ = batch[i].first;
+      itl->val_ = std::move(batch[i].second);
+      itl->clr_ = clr_;
+      itl_ = ListIterator(itl);
+      move2Front(itl_);
+    } else {
+      itl = newNode(batch[i].first, std::move(batch[i].second));
+    }
+    fresh.emplace_back(batch[i].first, itl);
+    count++;
+  }
+  std::reverse(fresh.begin(), fresh.end());
+  set_.insert_sorted(fresh);
+  ordersInsertSorted(fresh);
+  return count;
+}
 
 /*
 endend
@@ -28,7 +28,13 @@ The rationale for the trailing underscore and the global/static prefixes is that
 #include <cmath>
 #include <string>
 #include <random>
+#include "ComplexKernel.hpp"
+#include "CompressedMatrix.hpp"
 #include "Map.hpp"
+#include "Gustavson.hpp"
+#include "Parallel.hpp"
+#include "ProductPlan.hpp"
+#include "ShardedMap.hpp"
 #include <sstream>
 #include <iomanip>
 
@@ -50,6 +56,16 @@ class Matrix {
     bool operator <(const K& k) const {
       return x_ != k.x_ ? x_ < k.x_ : y_ < k.y_;
     }
+    struct Hash {
+      std::size_t operator()(const K& k) const {
+        return (std::size_t(k.x_) << 32) | k.y_;
+      }
+    };
+    struct LessYX {
+      bool operator()(const K& a, const K& b) const {
+        return a.y_ != b.y_ ? a.y_ < b.y_ : a.x_ < b.x_;
+      }
+    };
   };
   /* //////////////////////////////////////////////////////////////
   Value
@@ -69,18 +85,78 @@ class Matrix {
     }
   };
 
+  template<class Key, class ListT, class Compare>
+    using KeyIndex = HashIndex<Key, ListT, Compare, K::Hash>;
+  typedef Map<K,V,std::less<K>,KeyIndex> MapT;
+  typedef Map<K,V,std::less<K>,KeyIndex,K::LessYX> ColMapT;
+    /* also walks columns through order_begin<0>(), at the price of a
+    second ordered index on every insert; pesABt() reads B^t from it
+    with no sort */
+  typedef ShardedMap<K,V,std::less<K>,KeyIndex,K::Hash> ShardedMapT;
+  typedef CompressedMatrix<Index,Value> CompressedT;
+
+  /* //////////////////////////////////////////////////////////////
+  View, a matrix read as its transpose and/or with conjugated values,
+  without touching its entries
+  */ //////////////////////////////////////////////////////////////
+  class View {
+   public:
+    View(Matrix& m, bool transposed = false, bool conjugated = false) :
+      m_(&m), transposed_(transposed), conjugated_(conjugated) {}
+    bool transposed() const {return transposed_;}
+    bool conjugated() const {return conjugated_;}
+    View transpose() const {return View(*m_, !transposed_, conjugated_);}
+    View adjoint() const {return View(*m_, !transposed_, !conjugated_);}
+    template<class Visit> void forEach(Visit visit) const;
+   private:
+    Matrix* m_;
+    bool transposed_;
+    bool conjugated_;
+  };
+
   /* //////////////////////////////////////////////////////////////
   Methods
   */ //////////////////////////////////////////////////////////////
   void add(Index x, Index y, Value v);
+  static void add(ShardedMapT& acc, Index x, Index y, Value v);
+  void gather(const ShardedMapT& acc);
   void transpose_emplace();
+  void pesA(const Value& s, const Matrix& A);
+  View transpose() {return View(*this, true, false);}
+  View adjoint() {return View(*this, true, true);}
   void pesABt(const Value& s, Matrix& A, Matrix & B);
-  Value getCoeff(Index x, Index y);
+  void pesABt(const Value& s, const View& A, const View& B);
+  void pesABt(const Value& s, const View& A, const ColMapT& B);
+  void symbolicABt(Matrix& A, Matrix& B);
+  void symbolicABt(const View& A, const View& B);
+  void numericABt(const Value& s);
+  Value getCoeff(Index x, Index y) const;
+  std::size_t prune(double tol);
+  const CompressedT& csr();
+  CompressedT toCSR() {return csr();}
+  CompressedT toCSC() {return csr().transposed();}
+  void fromCSR(const CompressedT& csr);
+  void invalidate() {csr_valid_ = false;}
+    /* after writing a value through an iterator of map_ kept from before
+    the last csr(), which map_.edits() does not see */
+  void apply(const Value* x, Value* y, std::size_t n);
+  void apply(const Value& alpha, const Value* x, Value* y, std::size_t n);
+  unsigned threads() const {return threads_;}
+  void setThreads(unsigned threads) {threads_ = std::max(1u, threads);}
 
 
-  Map<K,V> map_;
+  MapT map_;
  private:
   Index index_max_ = UINT32_MAX;
+  unsigned threads_ = 1;
+  ProductPlan<Index,Value> plan_;
+  CompressedT csr_; // cached for apply, while csr_valid_
+  bool csr_valid_ = false;
+  uint64_t csr_edits_ = 0; // map_.edits() when csr_ was built
+  void pesABt(const Value& s, const View& A,
+    std::vector<Gustavson<Index,Value>::Entry>& right);
+  template<class Store>
+  void applyRows(const Value* x, Value* y, std::size_t n, Store store);
 };
 
 /* //////////////////////////////////////////////////////////////
@@ -90,23 +166,45 @@ Explicit Methods
 Matrix::
 Value
 Matrix::
-getCoeff(Matrix::Index x, Matrix::Index y) {
-  auto itm = map_.map_find(K(x,y));
-  if(itm != map_.map_end()) {
+getCoeff(Matrix::Index x, Matrix::Index y) const {
+  auto itm = map_.map_cfind(K(x,y));
+  if(itm != map_.map_cend() && itm->clr() == map_.getClr()) {
     return itm->val().v_;
   } else {
     return 0;
   }
 }
 
+std::size_t
+Matrix::
+prune(double tol) {
+  /* erases the entries with |v| <= tol, returns how many */
+  return map_.erase_if([&](const K&, const V& v) {return std::abs(v.v_) <= tol;});
+}
+
 void
 Matrix::
 add(Index x, Index y, Value v) {
-  auto itm = map_.map_find(K(x,y));
-  if(itm != map_.map_end() && itm->clr() == map_.getClr()) {
-    itm->val().v_ += v;
-  } else {
-    map_.try_emplace(K(x,y),V(v));
+  map_.upsert(K(x,y), V(v), [](V& a, const V& b) {a.v_ += b.v_;});
+}
+
+void
+Matrix::
+add(ShardedMapT& acc, Index x, Index y, Value v) {
+  /* safe from many threads at once */
+  acc.upsert(K(x,y), V(v), [](V& a, const V& b) {a.v_ += b.v_;});
+}
+
+void
+Matrix::
+gather(const ShardedMapT& acc) {
+  /* this += the live entries of acc, which no thread may write meanwhile */
+  for(std::size_t i = 0; i < acc.shards(); i++) {
+    auto& shard = acc.shard(i);
+    for(auto itl = shard.list_cbegin(); itl != shard.list_cend()
+      && itl->clr() == shard.getClr(); itl++) {
+      add(itl->key().x_, itl->key().y_, itl->val().v_);
+    }
   }
 }
 
@@ -136,47 +234,231 @@ transpose_emplace() {
   }
 }
 
+void
+Matrix::
+pesA(const Value& s, const Matrix& A) {
+  /* this += s*A in one merge of the two maps */
+  if(s == Value(1)) {
+    map_.merge(A.map_, [](V& a, const V& b) {a.v_ += b.v_;});
+  } else {
+    map_.merge(A.map_, [&](V& a, const V& b) {a.v_ += s*b.v_;},
+      [&](const V& b) {return V(s*b.v_);});
+  }
+}
+
+const Matrix::
+CompressedT&
+Matrix::
+csr() {
+  /* rebuilt after any change to map_, made through Matrix or not; the
+  list of the map, once sorted, holds the live entries in row-major
+  order */
+  if(csr_valid_ && csr_edits_ == map_.edits()) {return csr_;}
+  map_.sort_list();
+  csr_ = CompressedT();
+  csr_.reserve(map_.countLive());
+  for(auto itl = map_.list_cbegin(); itl != map_.list_cend()
+    && itl->clr() == map_.getClr(); itl++) {
+    csr_.append(itl->key().x_, itl->key().y_, itl->val().v_);
+  }
+  csr_edits_ = map_.edits();
+  csr_valid_ = true;
+  return csr_;
+}
+
+void
+Matrix::
+fromCSR(const CompressedT& csr) {
+  /* replaces the entries of this; entries that repeat a (row, col) are
+  summed, as add() does.  Every new node counts as moved, so the next
+  sort_list() sorts them all; csr is kept as the cached CSR when its rows
+  hold strictly increasing columns, which is what csr() would build */
+  map_.clear();
+  bool is_ordered = true;
+  for(Index x = 0; x < csr.rows(); x++) {
+    for(std::size_t i = csr.ptr()[x]; i < csr.ptr()[x+1]; i++) {
+      map_.upsert(K(x, csr.idx()[i]), V(csr.val()[i]),
+        [](V& a, const V& b) {a.v_ += b.v_;});
+      if(i > csr.ptr()[x] && csr.idx()[i-1] >= csr.idx()[i]) {
+        is_ordered = false;
+      }
+    }
+  }
+  csr_valid_ = false;
+  if(is_ordered) {
+    csr_ = csr;
+    csr_edits_ = map_.edits();
+    csr_valid_ = true;
+  }
+}
+
+template<class Store>
+void
+Matrix::
+applyRows(const Value* x, Value* y, std::size_t n, Store store) {
+  /* store(y[r], row r of A times x) for r < n, rows split across
+  threads in blocks of about equal nnz of A, cut at n when y is shorter;
+  rows past the last nonzero one get a product of 0 */
+  const CompressedT& a = csr();
+  std::size_t rows = std::min<std::size_t>(n, a.rows());
+  auto bounds = Parallel::balance(a.ptr(), threads_);
+  for(auto& b : bounds) {b = std::min(b, rows);}
+  Parallel::forBounds(bounds,
+    [&](std::size_t, std::size_t r0, std::size_t r1) {
+    const std::size_t* ptr = a.ptr().data();
+    for(std::size_t r = r0; r < r1; r++) {
+      store(y[r], ComplexKernel::dot(a.val().data() + ptr[r],
+        a.idx().data() + ptr[r], ptr[r+1] - ptr[r], x));
+    }
+  });
+  for(std::size_t r = rows; r < n; r++) {store(y[r], Value(0));}
+}
+
+void
+Matrix::
+apply(const Value* x, Value* y, std::size_t n) {
+  /* y = A*x for y of length n, the rows of A past csr().rows() are 0 */
+  applyRows(x, y, n, [](Value& yr, const Value& ax) {yr = ax;});
+}
+
+void
+Matrix::
+apply(const Value& alpha, const Value* x, Value* y, std::size_t n) {
+  /* y += alpha*A*x for y of length n */
+  applyRows(x, y, n, [&](Value& yr, const Value& ax) {yr += alpha*ax;});
+}
+
+template<class Visit>
+void
+Matrix::View::
+forEach(Visit visit) const {
+  /* visit(x, y, v) on each live entry, with x and y as seen through the
+  view and v the stored value, which the caller conjugates */
+  auto& map = m_->map_;
+  for(auto itl = map.list_begin(); itl != map.list_end()
+    && itl->clr() == map.getClr(); itl++) {
+    if(transposed_) {
+      visit(itl->key().y_, itl->key().x_, itl->val().v_);
+    } else {
+      visit(itl->key().x_, itl->key().y_, itl->val().v_);
+    }
+  }
+}
+
 void 
 Matrix::
 pesABt(const Value& s, Matrix& A, Matrix & B) {
+  /* the list of A, once sorted, gives its rows in order */
   A.map_.sort_list();
-  auto iA = A.map_.list_begin();
-  auto iA_old = A.map_.list_begin();
-  Matrix::Index xA;
-  Matrix::Index yA;
-  Matrix::Index vA;
-
-  B.map_.sort_list();
-  auto iB = B.map_.list_begin();
-  auto iB_old = B.map_.list_begin();
-  Matrix::Index xB;
-  Matrix::Index yB;
-  Matrix::Index vB;
-
-  Value res;
-
-  iA = A.map_.list_begin();
-  while(iA != A.map_.list_end()) {
-    xA = iA->key().x_;
-    iA_old = iA;
-    iB = B.map_.list_begin();
-    while(iB != B.map_.list_end()) {
-      xB = iB->key().x_;
-      iA = iA_old;
-      res = 0;
-      while(xA == iA->key().x_ && xB == iB->key().x_ 
-        && iA != A.map_.list_end() && iB != B.map_.list_end()) {
-        yA = iA->key().y_; yB = iB->key().y_;
-        if(yA == yB) {
-          res += iA->val().v_ * iB->val().v_;
-          iA++; iB++;
-        } else if(yA < yB) {iA++;} else {iB++;}
+  pesABt(s, View(A), View(B));
+}
+
+void 
+Matrix::
+pesABt(const Value& s, const View& A, const View& B) {
+  /* row k of B^t is column k of B */
+  std::vector<Gustavson<Index,Value>::Entry> entries;
+  B.forEach([&](const Index& x, const Index& y, const Value& v) {
+    entries.emplace_back(y, x, B.conjugated() ? std::conj(v) : v);
+  });
+  pesABt(s, A, entries);
+}
+
+void
+Matrix::
+pesABt(const Value& s, const View& A, const ColMapT& B) {
+  /* the column order of B walks the rows of B^t in order, so setRight()
+  takes them as they come */
+  std::vector<Gustavson<Index,Value>::Entry> entries;
+  for(auto it = B.order_cbegin<0>(); it != B.order_cend<0>(); it++) {
+    if(it->clr() == B.getClr()) {
+      entries.emplace_back(it->key().y_, it->key().x_, it->val().v_);
+    }
+  }
+  pesABt(s, A, entries);
+}
+
+void
+Matrix::
+pesABt(const Value& s, const View& A,
+  std::vector<Gustavson<Index,Value>::Entry>& right) {
+  /* Gustavson row-by-row product, "right" holds the entries of B^t */
+  using Engine = Gustavson<Index,Value>;
+  if(right.empty()) {return;}
+  Engine gustavson;
+  gustavson.setRight(right);
+
+  /* rows of A, split across threads in blocks of about equal nnz */
+  std::vector<Engine::Entry> left;
+  A.forEach([&](const Index& x, const Index& y, const Value& v) {
+    left.emplace_back(x, y, A.conjugated() ? std::conj(v) : v);
+  });
+  if(!std::is_sorted(left.begin(), left.end())) {
+    std::sort(left.begin(), left.end());
+  }
+  std::vector<std::size_t> rows;
+  for(std::size_t i = 0; i < left.size(); i++) {
+    if(rows.empty() || left[rows.back()].x_ != left[i].x_) {rows.push_back(i);}
+  }
+  rows.push_back(left.size());
+  auto bounds = Parallel::balance(rows, threads_);
+  std::vector<std::vector<Engine::Entry>> out(bounds.size()-1);
+
+  Parallel::forBounds(bounds,
+    [&](std::size_t b, std::size_t r0, std::size_t r1) {
+    Engine::Accumulator acc(gustavson);
+    std::size_t hint;
+    Matrix::Index xA;
+    for(std::size_t r = r0; r < r1; r++) {
+      xA = left[rows[r]].x_;
+      hint = 0;
+      for(std::size_t i = rows[r]; i < rows[r+1]; i++) {
+        gustavson.scatter(acc, left[i].y_, left[i].v_, hint);
       }
-      add(xA, xB, s*res);
-      while(xB == iB->key().x_ && iB != B.map_.list_end()) {iB++;}
+      acc.gather(gustavson, [&](const Index& xB, const Value& res) {
+        out[b].emplace_back(xA, xB, s*res);
+      });
     }
-    while(xA == iA->key().x_ && iA != A.map_.list_end()) {iA++;}
+  });
+
+  /* rows are disjoint, so the buffers merge in order without a lock */
+  for(auto& buffer : out) {
+    for(auto& e : buffer) {add(e.x_, e.y_, e.v_);}
   }
 }
 
+void
+Matrix::
+symbolicABt(Matrix& A, Matrix& B) {
+  symbolicABt(View(A), View(B));
+}
+
+void
+Matrix::
+symbolicABt(const View& A, const View& B) {
+  /* caches the pattern of A*B^t in this and the (a,b,c) value triples,
+  valid until an entry of A, B or this is inserted, erased or cleared */
+  using Operand = ProductPlan<Index,Value>::Operand;
+  std::vector<Operand> left;
+  std::vector<Operand> right;
+  A.forEach([&](const Index& x, const Index& y, const Value& v) {
+    left.emplace_back(x, y, &v);
+  });
+  B.forEach([&](const Index& x, const Index& y, const Value& v) {
+    right.emplace_back(y, x, &v);
+  });
+  plan_.symbolic(left, right, [&](const Index& x, const Index& y) {
+    add(x, y, 0);
+    return &(map_.map_find(K(x,y))->val().v_);
+  }, A.conjugated(), B.conjugated());
+}
+
+void
+Matrix::
+numericABt(const Value& s) {
+  /* this += s*A*B^t for the A and B given to symbolicABt */
+  csr_valid_ = false;
+  plan_.numeric(s, threads_);
+}
+
 #endif
@@ -12,6 +12,9 @@
 #include <chrono>
 #include <set>
 #include <unordered_set>
+#include "Gustavson.hpp"
+#include "Parallel.hpp"
+#include "ProductPlan.hpp"
 
 class Matrix {
  public:
@@ -84,6 +87,8 @@ class Matrix {
   */ ///////////////////////////////////////////////////////////////////
   Container container_;
   Index index_max_ = UINT32_MAX;
+  unsigned threads_ = 1;
+  ProductPlan<Index,Value> plan_;
   /* ///////////////////////////////////////////////////////////////////
   implicit methods
   */ ///////////////////////////////////////////////////////////////////
@@ -95,13 +100,16 @@ class Matrix {
   Container::index<order_xy>::type::iterator
     xy_find(const Matrix::Index& x, const Matrix::Index& y);
   void pesAB(const Value& s, Matrix& A, Matrix& B, bool sort);
+  void symbolicAB(Matrix& A, Matrix& B);
+  void numericAB(const Value& s);
   std::pair< Container::index<random_access>::type::iterator,
     Container::index<random_access>::type::iterator
   > random_access_equal_range_xy(const Index& x);
   std::pair< Container::index<random_access>::type::iterator,
     Container::index<random_access>::type::iterator
   > random_access_equal_range_yx(const Index& y);
-  void add(const Index& x, const Index& y, const Value& v, bool sort);
+  void add(const Index& x, const Index& y, const Value& v,
+    bool sort = false);
   Container::index<Matrix::order_xy>::type::iterator
     xy_begin();
   Container::index<Matrix::order_yx>::type::iterator
@@ -113,6 +121,8 @@ class Matrix {
   Value getCoeff(const Index x, const Index y);
   void clear();
   void reserve(Index m);
+  unsigned threads() const {return threads_;}
+  void setThreads(unsigned threads) {threads_ = std::max(1u, threads);}
 };
 
 /* ///////////////////////////////////////////////////////////////////
@@ -132,43 +142,82 @@ Matrix::Value Matrix::getCoeff(const Matrix::Index x, const Matrix::Index y) {
 }
 
 void Matrix::pesAB(const Matrix::Value& s, Matrix& A, Matrix& B, bool sort) {
-
-  if(sort) {
-    A.xy_sort();
-    B.yx_sort();
+  /* Gustavson row-by-row product, "sort" is kept for compatibility, rows
+  of A are read from order_xy so random_access order does not matter */
+  using Engine = Gustavson<Index,Value>;
+  std::vector<Engine::Entry> entries;
+  entries.reserve(B.container_.size());
+  for(auto& t : B.container_.get<order_xy>()) {
+    entries.emplace_back(t.x_, t.y_, t.v_);
   }
+  if(entries.empty()) {return;}
+  Engine gustavson;
+  gustavson.setRight(entries);
 
-  auto iA = A.random_access_begin();
-  auto iA_old = A.random_access_begin();
-  Index xA;
-
-  auto iB = B.random_access_begin();
-  Index yB;
-
-  Value v = 0;
+  /* rows of A, split across threads in blocks of about equal nnz */
+  using IterXY = Container::index<order_xy>::type::const_iterator;
+  std::vector<IterXY> rows;
+  std::vector<std::size_t> prefix;
+  std::size_t nnz = 0;
+  auto iA = A.container_.get<order_xy>().cbegin();
+  while(iA != A.container_.get<order_xy>().cend()) {
+    if(rows.empty() || rows.back()->x_ != iA->x_) {
+      rows.push_back(iA);
+      prefix.push_back(nnz);
+    }
+    nnz++; iA++;
+  }
+  rows.push_back(iA);
+  prefix.push_back(nnz);
+  auto bounds = Parallel::balance(prefix, threads_);
+  std::vector<std::vector<Engine::Entry>> out(bounds.size()-1);
 
-  while(iA != A.random_access_end()) {
-    xA = iA->x_;
-    iA_old = iA;
-    iB = B.random_access_begin();
-if(false) {
-    while(iB != B.random_access_end()) {
-      iA = iA_old;
-      yB = iB->y_;
-      v = 0;
-      while(xA == iA->x_ && iA != A.random_access_end()
-        && yB == iB->y_ && iB != B.random_access_end()) {
-        if(iA->y_ == iB->x_) {
-          v += iA->v_ * iB->v_;
-          iA++; iB++;
-        } else if(iA->y_ < iB->x_) { iA++; } else { iB++; }
+  Parallel::forBounds(bounds,
+    [&](std::size_t b, std::size_t r0, std::size_t r1) {
+    Engine::Accumulator acc(gustavson);
+    std::size_t hint;
+    Index xA;
+    for(std::size_t r = r0; r < r1; r++) {
+      xA = rows[r]->x_;
+      hint = 0;
+      for(auto itA = rows[r]; itA != rows[r+1]; itA++) {
+        gustavson.scatter(acc, itA->y_, itA->v_, hint);
       }
-      add(xA, yB, s*v, sort);
-      while(yB == iB->y_ && iB != B.random_access_end()) {iB++;}
+      acc.gather(gustavson, [&](const Index& yB, const Value& v) {
+        out[b].emplace_back(xA, yB, s*v);
+      });
     }
+  });
+
+  /* rows are disjoint, so the buffers merge in order without a lock */
+  for(auto& buffer : out) {
+    for(auto& e : buffer) {add(e.x_, e.y_, e.v_, sort);}
+  }
 }
-    while(xA == iA->x_ && iA != A.random_access_end()) {iA++;}
+
+void Matrix::symbolicAB(Matrix& A, Matrix& B) {
+  /* caches the pattern of A*B in this and the (a,b,c) value triples,
+  valid until an entry of A, B or this is inserted, erased or cleared */
+  using Operand = ProductPlan<Index,Value>::Operand;
+  std::vector<Operand> left;
+  std::vector<Operand> right;
+  left.reserve(A.container_.size());
+  for(auto& t : A.container_.get<order_xy>()) {
+    left.emplace_back(t.x_, t.y_, &t.v_);
+  }
+  right.reserve(B.container_.size());
+  for(auto& t : B.container_.get<order_xy>()) {
+    right.emplace_back(t.x_, t.y_, &t.v_);
   }
+  plan_.symbolic(left, right, [&](const Index& x, const Index& y) {
+    add(x, y, 0);
+    return &(xy_find(x,y)->v_);
+  });
+}
+
+void Matrix::numericAB(const Matrix::Value& s) {
+  /* this += s*A*B for the A and B given to symbolicAB */
+  plan_.numeric(s, threads_);
 }
 
 void Matrix::
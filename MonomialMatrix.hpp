@@ -0,0 +1,272 @@
+/*
+  Copyright Benjamin Commeau
+
+Use CamelCase for all names. Start types (such as classes, structs, and typedefs) with a capital letter, other names (functions, variables) with a lowercase letter. You may use an all-lowercase name with underscores if your class closely resembles an external construct (e.g., a standard library construct) named that way.
+
+(1) C++ interfaces are named with a Interface suffix, and abstract base classes with an Abstract prefix.
+(2) Member variables are named with a trailing underscore.
+(3) Accessors for a variable foo_ are named foo() and setFoo().
+(4) Global variables are named with a g_ prefix.
+(5) Static class variables are named with a s_ prefix.
+(6) Global constants are often named with a c_ prefix.
+(7) If the main responsibility of a file is to implement a particular class, then the name of the file should match that class, except for possible abbreviations to avoid repetition in file names (e.g., if all classes within a module start with the module name, omitting or abbreviating the module name is OK). Currently, all source file names are lowercase, but this casing difference should be the only difference.
+
+The rationale for the trailing underscore and the global/static prefixes is that it is immediately clear whether a variable referenced in a method is local to the function or has wider scope, improving the readability of the code.
+*/
+
+#include <algorithm>
+#include <bit>
+#include <complex>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "ComplexKernel.hpp"
+#include "CompressedMatrix.hpp"
+#include "Matrix2.hpp"
+#include "Parallel.hpp"
+#include "PauliString.hpp"
+/* //////////////////////////////////////////////////////////////
+Class Definition
+
+Square matrix with at most one nonzero per row, such as a Pauli string,
+an X-type gate or a permutation times a diagonal.  Row r holds its value
+val(r) at column col(r), where col(r) is either read from a column map
+or, for strings of X and Z, taken as r ^ mask() with no map at all.
+That is 16 or 20 bytes a row, against a key, a list node and an index
+slot per entry in Matrix.  A product is one gather per row, O(n), and
+so is y = A*x.  An empty row holds the value 0.
+*/ //////////////////////////////////////////////////////////////
+#ifndef MONOMIAL_MATRIX_HPP
+#define MONOMIAL_MATRIX_HPP
+class MonomialMatrix {
+ public:
+  typedef Matrix::Index Index;
+  typedef Matrix::Value Value;
+  typedef CompressedMatrix<Index,Value> CompressedT;
+  /* //////////////////////////////////////////////////////////////
+  Implicit Methods
+  */ //////////////////////////////////////////////////////////////
+  MonomialMatrix() {}
+  MonomialMatrix(Index rows, Index mask = 0);
+  MonomialMatrix(std::vector<Index> col, std::vector<Value> val) :
+    col_(std::move(col)), val_(std::move(val)) {}
+  Index rows() const {return Index(val_.size());}
+  bool masked() const {return col_.empty();}
+  Index mask() const {return mask_;}
+  Index col(Index r) const {return masked() ? r ^ mask_ : col_[r];}
+  const Value& val(Index r) const {return val_[r];}
+  const std::vector<Value>& val() const {return val_;}
+  std::vector<Value>& val() {return val_;}
+  void set(Index r, Index c, const Value& v);
+  void unmask();
+  MonomialMatrix& operator*=(const MonomialMatrix& B);
+  friend MonomialMatrix operator*(MonomialMatrix A, const MonomialMatrix& B)
+    {return A *= B;}
+  MonomialMatrix adjoint() const;
+  template<std::size_t W>
+  bool fromPauli(const PauliString<W>& p, std::size_t qubits);
+  bool fromMatrix(Matrix& m, Index rows);
+  CompressedT toCSR() const;
+  void toMatrix(Matrix& m) const {m.fromCSR(toCSR());}
+  void apply(const Value* x, Value* y) const;
+  void apply(const Value& alpha, const Value* x, Value* y) const;
+  unsigned threads() const {return threads_;}
+  void setThreads(unsigned threads) {threads_ = std::max(1u, threads);}
+ private:
+  std::vector<Index> col_; // empty while masked
+  std::vector<Value> val_;
+  Index mask_ = 0;
+  unsigned threads_ = 1;
+};
+
+/* //////////////////////////////////////////////////////////////
+Explicit Methods
+*/ //////////////////////////////////////////////////////////////
+
+MonomialMatrix::
+MonomialMatrix(Index rows, Index mask) :
+  val_(rows, Value(1)), mask_(mask) {
+  /* the rows x rows matrix with ones at (r, r ^ mask); a row whose column
+  r ^ mask falls outside is left empty, at column r, as in fromMatrix */
+  Index r = 0;
+  while(r < rows && (r ^ mask) < rows) {r++;}
+  if(r == rows) {return;}
+  unmask();
+  for(; r < rows; r++) {
+    if(col_[r] >= rows) {col_[r] = r; val_[r] = 0;}
+  }
+}
+
+void
+MonomialMatrix::
+unmask() {
+  /* writes the columns r ^ mask() into a column map */
+  if(!masked()) {return;}
+  col_.resize(rows());
+  for(Index r = 0; r < rows(); r++) {col_[r] = r ^ mask_;}
+  mask_ = 0;
+}
+
+void
+MonomialMatrix::
+set(Index r, Index c, const Value& v) {
+  /* replaces row r by v at column c */
+  if(masked() && c != (r ^ mask_)) {unmask();}
+  if(!masked()) {col_[r] = c;}
+  val_[r] = v;
+}
+
+MonomialMatrix&
+MonomialMatrix::
+operator*=(const MonomialMatrix& B) {
+  /* (A*B)(r, B.col(A.col(r))) = A.val(r)*B.val(A.col(r)); both square of
+  the same size.  Two masks multiply into their XOR.  The rows are
+  written to new arrays, as B may be this */
+  bool is_masked = masked() && B.masked();
+  std::vector<Value> vals(rows());
+  std::vector<Index> cols(is_masked ? 0 : rows());
+  Parallel::forBlocks(rows(), threads_,
+    [&](std::size_t, std::size_t r0, std::size_t r1) {
+    for(std::size_t r = r0; r < r1; r++) {
+      Index k = col(Index(r));
+      vals[r] = ComplexKernel::mul(val_[r], B.val_[k]);
+      if(!is_masked) {cols[r] = B.col(k);}
+    }
+  });
+  mask_ = is_masked ? mask_ ^ B.mask_ : 0;
+  val_.swap(vals);
+  col_.swap(cols);
+  return *this;
+}
+
+MonomialMatrix
+MonomialMatrix::
+adjoint() const {
+  /* the conjugate transpose, when no two rows share a column, as for a
+  permutation times a diagonal */
+  MonomialMatrix a;
+  a.val_.resize(rows());
+  a.mask_ = mask_;
+  a.threads_ = threads_;
+  if(!masked()) {a.col_.assign(rows(), 0);}
+  for(Index r = 0; r < rows(); r++) {
+    Index c = col(r);
+    a.val_[c] = std::conj(val_[r]);
+    if(!masked()) {a.col_[c] = r;}
+  }
+  return a;
+}
+
+template<std::size_t W>
+bool
+MonomialMatrix::
+fromPauli(const PauliString<W>& p, std::size_t qubits) {
+  /* the 2^qubits matrix of p: i^phase (-1)^|z & c| at (c ^ x, c).  p acts
+  on the first qubits only, qubits fewer than the bits of Index; false,
+  and this unchanged, otherwise */
+  if(qubits >= 8*sizeof(Index)) {return false;}
+  if((p.x()[0] | p.z()[0]) >> qubits) {return false;}
+  for(std::size_t w = 1; w < W; w++) {
+    if(p.x()[w] | p.z()[w]) {return false;}
+  }
+  Index x = Index(p.x()[0]);
+  std::uint64_t z = p.z()[0];
+  Value c = PauliString<W>::power(p.phase());
+  col_.clear();
+  mask_ = x;
+  val_.resize(std::size_t(1) << qubits);
+  for(Index r = 0; r < rows(); r++) {
+    val_[r] = (std::popcount(z & (r ^ x)) & 1) ? -c : c;
+  }
+  return true;
+}
+
+bool
+MonomialMatrix::
+fromMatrix(Matrix& m, Index rows) {
+  /* m as a rows x rows matrix; false, and this unchanged, when a row
+  holds more than one entry or an entry lies outside.  Stays masked when
+  r ^ mask < rows for every r and each nonempty row r has its entry at
+  r ^ mask for one mask, else empty rows get the column r */
+  const CompressedT& csr = m.csr();
+  for(Index r = 0; r < csr.rows(); r++) {
+    std::size_t n = csr.ptr()[r+1] - csr.ptr()[r];
+    if(n > 1 || (n == 1 && (r >= rows || csr.idx()[csr.ptr()[r]] >= rows))) {
+      return false;
+    }
+  }
+  std::vector<Index> col(rows);
+  std::vector<Value> val(rows, Value(0));
+  bool is_masked = true;
+  Index mask = 0;
+  bool has_mask = false;
+  for(Index r = 0; r < rows; r++) {
+    col[r] = r;
+    if(r >= csr.rows() || csr.ptr()[r] == csr.ptr()[r+1]) {continue;}
+    col[r] = csr.idx()[csr.ptr()[r]];
+    val[r] = csr.val()[csr.ptr()[r]];
+    if(!has_mask) {
+      mask = r ^ col[r];
+      has_mask = true;
+    }
+    is_masked = is_masked && (col[r] == (r ^ mask));
+  }
+  for(Index r = 0; r < rows && is_masked; r++) {
+    is_masked = (r ^ mask) < rows;
+  }
+  val_ = std::move(val);
+  mask_ = is_masked ? mask : 0;
+  if(is_masked) {col_.clear();} else {col_ = std::move(col);}
+  return true;
+}
+
+MonomialMatrix::
+CompressedT
+MonomialMatrix::
+toCSR() const {
+  /* rows holding 0 are left empty */
+  CompressedT csr;
+  csr.reserve(rows());
+  for(Index r = 0; r < rows(); r++) {
+    if(val_[r] != Value(0)) {csr.append(r, col(r), val_[r]);}
+  }
+  csr.resize(rows(), rows());
+  return csr;
+}
+
+void
+MonomialMatrix::
+apply(const Value* x, Value* y) const {
+  /* y = A*x, a gather and a multiply per row */
+  Parallel::forBlocks(rows(), threads_,
+    [&](std::size_t, std::size_t r0, std::size_t r1) {
+    if(masked()) {
+      for(std::size_t r = r0; r < r1; r++) {
+        y[r] = ComplexKernel::mul(val_[r], x[r ^ mask_]);
+      }
+    } else {
+      for(std::size_t r = r0; r < r1; r++) {
+        y[r] = ComplexKernel::mul(val_[r], x[col_[r]]);
+      }
+    }
+  });
+}
+
+void
+MonomialMatrix::
+apply(const Value& alpha, const Value* x, Value* y) const {
+  /* y += alpha*A*x */
+  Parallel::forBlocks(rows(), threads_,
+    [&](std::size_t, std::size_t r0, std::size_t r1) {
+    for(std::size_t r = r0; r < r1; r++) {
+      y[r] += ComplexKernel::mul(alpha,
+        ComplexKernel::mul(val_[r], x[col(Index(r))]));
+    }
+  });
+}
+
+/*
+endend
+*/
+
+#endif
@@ -0,0 +1,98 @@
+/*
+  Copyright Benjamin Commeau
+
+Use CamelCase for all names. Start types (such as classes, structs, and typedefs) with a capital letter, other names (functions, variables) with a lowercase letter. You may use an all-lowercase name with underscores if your class closely resembles an external construct (e.g., a standard library construct) named that way.
+
+(1) C++ interfaces are named with a Interface suffix, and abstract base classes with an Abstract prefix.
+(2) Member variables are named with a trailing underscore.
+(3) Accessors for a variable foo_ are named foo() and setFoo().
+(4) Global variables are named with a g_ prefix.
+(5) Static class variables are named with a s_ prefix.
+(6) Global constants are often named with a c_ prefix.
+(7) If the main responsibility of a file is to implement a particular class, then the name of the file should match that class, except for possible abbreviations to avoid repetition in file names (e.g., if all classes within a module start with the module name, omitting or abbreviating the module name is OK). Currently, all source file names are lowercase, but this casing difference should be the only difference.
+
+The rationale for the trailing underscore and the global/static prefixes is that it is immediately clear whether a variable referenced in a method is local to the function or has wider scope, improving the readability of the code.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+/* //////////////////////////////////////////////////////////////
+Class Definition
+
+Splits [0,n) into one contiguous block per worker thread.  Block 0 runs
+on the calling thread, so a thread count of 1 never spawns a thread.
+*/ //////////////////////////////////////////////////////////////
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+class Parallel {
+ public:
+  static unsigned hardware() {
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+  static std::size_t blocks(std::size_t n, unsigned threads) {
+    return std::max<std::size_t>(1, std::min<std::size_t>(n, threads));
+  }
+  static std::vector<std::size_t>
+    balance(const std::vector<std::size_t>& prefix, unsigned threads);
+  template<class F>
+  static void forBlocks(std::size_t n, unsigned threads, F f);
+  template<class F>
+  static void forBounds(const std::vector<std::size_t>& bounds, F f);
+};
+
+/* //////////////////////////////////////////////////////////////
+Explicit Methods
+*/ //////////////////////////////////////////////////////////////
+
+std::vector<std::size_t>
+Parallel::
+balance(const std::vector<std::size_t>& prefix, unsigned threads) {
+  /* "prefix" holds the running work before each item, prefix.back() is
+  the total, the returned bounds split the items into blocks of about
+  equal work */
+  std::size_t n = prefix.empty() ? 0 : prefix.size() - 1;
+  std::size_t m = blocks(n, threads);
+  std::vector<std::size_t> bounds(m+1, n);
+  bounds[0] = 0;
+  for(std::size_t b = 1; b < m; b++) {
+    std::size_t target = (prefix.back()*b)/m;
+    bounds[b] = std::lower_bound(prefix.begin() + bounds[b-1],
+      prefix.end() - 1, target) - prefix.begin();
+  }
+  return bounds;
+}
+
+template<class F>
+void
+Parallel::
+forBlocks(std::size_t n, unsigned threads, F f) {
+  /* f(block, begin, end) */
+  std::size_t m = blocks(n, threads);
+  std::vector<std::size_t> bounds(m+1);
+  for(std::size_t b = 0; b <= m; b++) {bounds[b] = (n*b)/m;}
+  forBounds(bounds, f);
+}
+
+template<class F>
+void
+Parallel::
+forBounds(const std::vector<std::size_t>& bounds, F f) {
+  /* f(block, bounds[block], bounds[block+1]) */
+  if(bounds.size() < 2) {return;}
+  std::size_t m = bounds.size() - 1;
+  std::vector<std::thread> workers;
+  workers.reserve(m - 1);
+  for(std::size_t b = 1; b < m; b++) {
+    workers.emplace_back(f, b, bounds[b], bounds[b+1]);
+  }
+  f(std::size_t(0), bounds[0], bounds[1]);
+  for(auto& w : workers) {w.join();}
+}
+
+/*
+endend
+*/
+
+#endif
@@ -0,0 +1,211 @@
+/*
+  Copyright Benjamin Commeau
+
+Use CamelCase for all names. Start types (such as classes, structs, and typedefs) with a capital letter, other names (functions, variables) with a lowercase letter. You may use an all-lowercase name with underscores if your class closely resembles an external construct (e.g., a standard library construct) named that way.
+
+(1) C++ interfaces are named with a Interface suffix, and abstract base classes with an Abstract prefix.
+(2) Member variables are named with a trailing underscore.
+(3) Accessors for a variable foo_ are named foo() and setFoo().
+(4) Global variables are named with a g_ prefix.
+(5) Static class variables are named with a s_ prefix.
+(6) Global constants are often named with a c_ prefix.
+(7) If the main responsibility of a file is to implement a particular class, then the name of the file should match that class, except for possible abbreviations to avoid repetition in file names (e.g., if all classes within a module start with the module name, omitting or abbreviating the module name is OK). Currently, all source file names are lowercase, but this casing difference should be the only difference.
+
+The rationale for the trailing underscore and the global/static prefixes is that it is immediately clear whether a variable referenced in a method is local to the function or has wider scope, improving the readability of the code.
+*/
+
+#include <array>
+#include <bit>
+#include <complex>
+#include <cstdint>
+#include <functional>
+#include <string>
+/* //////////////////////////////////////////////////////////////
+Class Definition
+
+Pauli string on W*64 qubits in symplectic form,
+  P = i^phase * X^x Z^z,
+with one bit of x and of z per qubit, so Y = i*X*Z.  Moving Z^z1 past
+X^x2 gives (-1)^|z1 & x2|, hence
+  P1*P2 = i^(phase1 + phase2 + 2|z1 & x2|) * X^(x1^x2) Z^(z1^z2)
+costs W XORs and popcounts, and never a 2^q-dimensional matrix.
+On a basis state, P|b> = i^phase (-1)^|z & b| |b^x>.
+*/ //////////////////////////////////////////////////////////////
+#ifndef PAULI_STRING_HPP
+#define PAULI_STRING_HPP
+template<std::size_t W = 1>
+class PauliString {
+ public:
+  typedef std::array<std::uint64_t, W> Bits;
+  static constexpr std::size_t c_qubits = 64*W;
+  struct Hash {
+    std::size_t operator()(const PauliString& p) const {
+      std::uint64_t h = p.phase_;
+      for(std::size_t w = 0; w < W; w++) {
+        h = (h ^ p.x_[w])*UINT64_C(0x9E3779B97F4A7C15);
+        h = (h ^ p.z_[w])*UINT64_C(0x9E3779B97F4A7C15);
+      }
+      return std::size_t(h ^ (h >> 29));
+    }
+  };
+  /* //////////////////////////////////////////////////////////////
+  Implicit Methods
+  */ //////////////////////////////////////////////////////////////
+  PauliString() {x_.fill(0); z_.fill(0);}
+  PauliString(const std::string& s);
+  PauliString(const Bits& x, const Bits& z, unsigned phase = 0) :
+    x_(x), z_(z), phase_(phase & 3) {}
+  const Bits& x() const {return x_;}
+  const Bits& z() const {return z_;}
+  unsigned phase() const {return phase_;}
+  void setPhase(unsigned phase) {phase_ = phase & 3;}
+  char get(std::size_t q) const;
+  void set(std::size_t q, char c);
+  std::size_t weight() const;
+  bool commutes(const PauliString& p) const;
+  PauliString& operator*=(const PauliString& p);
+  friend PauliString operator*(PauliString a, const PauliString& b)
+    {return a *= b;}
+  bool operator==(const PauliString& p) const
+    {return phase_ == p.phase_ && x_ == p.x_ && z_ == p.z_;}
+  bool operator!=(const PauliString& p) const {return !(*this == p);}
+  bool operator<(const PauliString& p) const;
+  static std::complex<double> power(unsigned phase);
+  static std::complex<double> rotate(const std::complex<double>& c,
+    unsigned phase);
+  std::string to_string() const;
+ private:
+  Bits x_;
+  Bits z_;
+  std::uint8_t phase_ = 0;
+};
+
+/* //////////////////////////////////////////////////////////////
+Explicit Methods
+*/ //////////////////////////////////////////////////////////////
+
+template<std::size_t W>
+PauliString<W>::
+PauliString(const std::string& s) : PauliString() {
+  /* s[q] in "IXYZ" is the operator on qubit q */
+  for(std::size_t q = 0; q < s.size() && q < c_qubits; q++) {set(q, s[q]);}
+}
+
+template<std::size_t W>
+char
+PauliString<W>::
+get(std::size_t q) const {
+  bool x = (x_[q/64] >> (q%64)) & 1;
+  bool z = (z_[q/64] >> (q%64)) & 1;
+  return x ? (z ? 'Y' : 'X') : (z ? 'Z' : 'I');
+}
+
+template<std::size_t W>
+void
+PauliString<W>::
+set(std::size_t q, char c) {
+  /* replaces the operator on qubit q, a Y brings its own factor i */
+  std::uint64_t bit = std::uint64_t(1) << (q%64);
+  if(get(q) == 'Y') {phase_ = (phase_ + 3) & 3;}
+  x_[q/64] &= ~bit;
+  z_[q/64] &= ~bit;
+  if(c == 'X' || c == 'Y') {x_[q/64] |= bit;}
+  if(c == 'Z' || c == 'Y') {z_[q/64] |= bit;}
+  if(c == 'Y') {phase_ = (phase_ + 1) & 3;}
+}
+
+template<std::size_t W>
+std::size_t
+PauliString<W>::
+weight() const {
+  std::size_t count = 0;
+  for(std::size_t w = 0; w < W; w++) {count += std::popcount(x_[w] | z_[w]);}
+  return count;
+}
+
+template<std::size_t W>
+bool
+PauliString<W>::
+commutes(const PauliString& p) const {
+  std::size_t count = 0;
+  for(std::size_t w = 0; w < W; w++) {
+    count += std::popcount((x_[w] & p.z_[w]) ^ (z_[w] & p.x_[w]));
+  }
+  return (count & 1) == 0;
+}
+
+template<std::size_t W>
+PauliString<W>&
+PauliString<W>::
+operator*=(const PauliString& p) {
+  std::size_t count = 0;
+  for(std::size_t w = 0; w < W; w++) {
+    count += std::popcount(z_[w] & p.x_[w]);
+    x_[w] ^= p.x_[w];
+    z_[w] ^= p.z_[w];
+  }
+  phase_ = (phase_ + p.phase_ + 2*count) & 3;
+  return *this;
+}
+
+template<std::size_t W>
+bool
+PauliString<W>::
+operator<(const PauliString& p) const {
+  for(std::size_t w = 0; w < W; w++) {
+    if(x_[w] != p.x_[w]) {return x_[w] < p.x_[w];}
+    if(z_[w] != p.z_[w]) {return z_[w] < p.z_[w];}
+  }
+  return phase_ < p.phase_;
+}
+
+template<std::size_t W>
+std::complex<double>
+PauliString<W>::
+power(unsigned phase) {
+  /* i^phase */
+  switch(phase & 3) {
+    case 0: return std::complex<double>(1, 0);
+    case 1: return std::complex<double>(0, 1);
+    case 2: return std::complex<double>(-1, 0);
+    default: return std::complex<double>(0, -1);
+  }
+}
+
+template<std::size_t W>
+std::complex<double>
+PauliString<W>::
+rotate(const std::complex<double>& c, unsigned phase) {
+  /* c*i^phase by swapping and negating parts, with no multiply */
+  switch(phase & 3) {
+    case 0: return c;
+    case 1: return std::complex<double>(-c.imag(), c.real());
+    case 2: return -c;
+    default: return std::complex<double>(c.imag(), -c.real());
+  }
+}
+
+template<std::size_t W>
+std::string
+PauliString<W>::
+to_string() const {
+  /* e.g. "-iXIYZ", up to the last qubit that is not I, with the factor
+  i of each Y already taken out of the sign */
+  std::size_t last = 0;
+  unsigned phase = phase_;
+  for(std::size_t q = 0; q < c_qubits; q++) {
+    char c = get(q);
+    if(c != 'I') {last = q+1;}
+    if(c == 'Y') {phase += 3;}
+  }
+  const char* sign[4] = {"", "i", "-", "-i"};
+  std::string s = sign[phase & 3];
+  for(std::size_t q = 0; q < last; q++) {s += get(q);}
+  return last == 0 ? s + "I" : s;
+}
+
+/*
+endend
+*/
+
+#endif
@@ -0,0 +1,394 @@
+/*
+  Copyright Benjamin Commeau
+
+Use CamelCase for all names. Start types (such as classes, structs, and typedefs) with a capital letter, other names (functions, variables) with a lowercase letter. You may use an all-lowercase name with underscores if your class closely resembles an external construct (e.g., a standard library construct) named that way.
+
+(1) C++ interfaces are named with a Interface suffix, and abstract base classes with an Abstract prefix.
+(2) Member variables are named with a trailing underscore.
+(3) Accessors for a variable foo_ are named foo() and setFoo().
+(4) Global variables are named with a g_ prefix.
+(5) Static class variables are named with a s_ prefix.
+(6) Global constants are often named with a c_ prefix.
+(7) If the main responsibility of a file is to implement a particular class, then the name of the file should match that class, except for possible abbreviations to avoid repetition in file names (e.g., if all classes within a module start with the module name, omitting or abbreviating the module name is OK). Currently, all source file names are lowercase, but this casing difference should be the only difference.
+
+The rationale for the trailing underscore and the global/static prefixes is that it is immediately clear whether a variable referenced in a method is local to the function or has wider scope, improving the readability of the code.
+*/
+
+#include <algorithm>
+#include <bit>
+#include <complex>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ComplexKernel.hpp"
+#include "CompressedMatrix.hpp"
+#include "HashIndex.hpp"
+#include "Map.hpp"
+#include "Parallel.hpp"
+#include "PauliString.hpp"
+#include "TermCollector.hpp"
+/* //////////////////////////////////////////////////////////////
+Class Definition
+
+Sum of Pauli strings with complex coefficients, c_1 P_1 + c_2 P_2 + ...
+Each string is stored with phase 0, its phase folded into its
+coefficient, in a Map with a hashed index, so adding a term is one
+lookup.  Products multiply every pair of terms, with no matrix of the
+operator ever built, and collect the like terms in a TermCollector
+before any of them reaches the Map, which then gets one upsert per
+distinct string.  The list of the Map is left in string order, so
+terms() of a product is its canonical sorted sum.
+toCSR() writes the matrix on the first qubits straight into compressed
+rows.  A string has one nonzero per row, X^x Z^z having (-1)^|z & c| at
+(c^x, c), so row r gathers one entry per distinct X-mask of the sum and
+needs no lookup at all.  A first pass counts the entries of each row, so
+the arrays are allocated once at their final size.
+*/ //////////////////////////////////////////////////////////////
+#ifndef PAULI_SUM_HPP
+#define PAULI_SUM_HPP
+template<std::size_t W = 1>
+class PauliSum {
+ public:
+  typedef PauliString<W> StringT;
+  typedef std::complex<double> Value;
+  /* //////////////////////////////////////////////////////////////
+  Coefficient
+  */ //////////////////////////////////////////////////////////////
+  struct V {
+    Value v_;
+    V() {}
+    V(const Value& v) {v_ = v;}
+    std::string to_string() const {
+      std::stringstream stream;
+      stream << std::fixed << std::setprecision(2);
+      stream << "(" << v_.real() << "," << v_.imag() << ")";
+      return stream.str();
+    }
+  };
+  template<class Key, class ListT, class Compare>
+    using TermIndex = HashIndex<Key, ListT, Compare, typename StringT::Hash>;
+  typedef Map<StringT,V,std::less<StringT>,TermIndex> MapT;
+
+  /* //////////////////////////////////////////////////////////////
+  Methods
+  */ //////////////////////////////////////////////////////////////
+  void add(const StringT& p, const Value& c);
+  void pesA(const Value& s, const PauliSum& A);
+  void pesAB(const Value& s, const PauliSum& A, const PauliSum& B,
+    double tol = 0);
+  void pesComm(const Value& s, const PauliSum& A, const PauliSum& B,
+    double tol = 0);
+  void collect(TermCollector<W>& terms);
+  void canonicalize(double tol = 0);
+  Value getCoeff(const StringT& p) const;
+  std::size_t size() const {return map_.countLive();}
+  std::size_t prune(double tol);
+  void clear() {map_.clear();}
+  std::vector<std::pair<StringT,Value>> terms() const;
+  template<class Index>
+  bool toCSR(CompressedMatrix<Index,Value>& csr, std::size_t qubits,
+    unsigned threads = 1, double tol = 0) const;
+  std::string to_string() const;
+
+  MapT map_;
+ private:
+  struct Node {
+    unsigned bit_; int lower_; int upper_;
+  };
+  static int trie(const std::vector<std::uint64_t>& mask, std::size_t lo,
+    std::size_t hi, std::vector<Node>& nodes);
+  template<bool Comm>
+  void product(const Value& s, const PauliSum& A, const PauliSum& B,
+    double tol);
+};
+
+/* //////////////////////////////////////////////////////////////
+Explicit Methods
+*/ //////////////////////////////////////////////////////////////
+
+template<std::size_t W>
+void
+PauliSum<W>::
+add(const StringT& p, const Value& c) {
+  StringT key = p;
+  key.setPhase(0);
+  map_.upsert(key, V(StringT::rotate(c, p.phase())),
+    [](V& a, const V& b) {a.v_ += b.v_;});
+}
+
+template<std::size_t W>
+void
+PauliSum<W>::
+pesA(const Value& s, const PauliSum& A) {
+  /* this += s*A */
+  for(auto& t : A.terms()) {add(t.first, s*t.second);}
+}
+
+template<std::size_t W>
+template<bool Comm>
+void
+PauliSum<W>::
+product(const Value& s, const PauliSum& A, const PauliSum& B, double tol) {
+  /* this += s*A*B, or s*[A,B] when Comm.  The strings of both operands
+  have phase 0, so P_a*P_b = (-1)^|z_a & x_b| X^(x_a^x_b) Z^(z_a^z_b): a
+  sign, not a rotation.  Single-word operands on few qubits, whose
+  products are at least a quarter of the 4^q strings, are collected in a
+  dense array, see TermCollector; it costs about as much to clear and
+  scan as that many adds to the table */
+  auto a = A.terms();
+  auto b = B.terms();
+  std::uint64_t bits = 0;
+  for(auto* t : {&a, &b}) {
+    for(auto& p : *t) {
+      bits |= p.first.x()[0] | p.first.z()[0];
+    }
+  }
+  std::size_t qubits = std::bit_width(bits);
+  if(qubits > TermCollector<W>::c_dense
+    || 4*a.size()*b.size() < (std::size_t(1) << (2*qubits))) {
+    qubits = StringT::c_qubits;
+  }
+  TermCollector<W> terms(tol, qubits);
+  terms.reserve(std::max(a.size(), b.size()));
+  typename StringT::Bits x;
+  typename StringT::Bits z;
+  for(auto& ta : a) {
+    Value sa = (Comm ? 2. : 1.)*s*ta.second;
+    const auto& xa = ta.first.x();
+    const auto& za = ta.first.z();
+    for(auto& tb : b) {
+      const auto& xb = tb.first.x();
+      const auto& zb = tb.first.z();
+      std::size_t sign = 0;
+      std::size_t anti = 0;
+      for(std::size_t w = 0; w < W; w++) {
+        sign += std::popcount(za[w] & xb[w]);
+        if(Comm) {anti += std::popcount((xa[w] & zb[w]) ^ (za[w] & xb[w]));}
+        x[w] = xa[w] ^ xb[w];
+        z[w] = za[w] ^ zb[w];
+      }
+      if(Comm && (anti & 1) == 0) {continue;}
+      Value c = ComplexKernel::mul(sa, tb.second);
+      terms.add(x, z, (sign & 1) ? -c : c);
+    }
+  }
+  collect(terms);
+}
+
+template<std::size_t W>
+void
+PauliSum<W>::
+pesAB(const Value& s, const PauliSum& A, const PauliSum& B, double tol) {
+  /* this += s*A*B, both operands are copied out first, so either may
+  be this; collected products with |c| <= tol are not added */
+  product<false>(s, A, B, tol);
+}
+
+template<std::size_t W>
+void
+PauliSum<W>::
+pesComm(const Value& s, const PauliSum& A, const PauliSum& B, double tol) {
+  /* this += s*(A*B - B*A); only anticommuting pairs remain, each as
+  2*P_a*P_b */
+  product<true>(s, A, B, tol);
+}
+
+template<std::size_t W>
+void
+PauliSum<W>::
+collect(TermCollector<W>& terms) {
+  /* adds the collected terms, in string order, and leaves the list
+  sorted */
+  for(auto& t : terms.sorted()) {
+    map_.upsert(t.first, V(t.second), [](V& a, const V& b) {a.v_ += b.v_;});
+  }
+  map_.sort_list();
+}
+
+template<std::size_t W>
+void
+PauliSum<W>::
+canonicalize(double tol) {
+  /* drops the terms with |c| <= tol and sorts the rest by string */
+  prune(tol);
+  map_.sort_list();
+}
+
+template<std::size_t W>
+typename PauliSum<W>::
+Value
+PauliSum<W>::
+getCoeff(const StringT& p) const {
+  /* coefficient of p as given, phase included */
+  StringT key = p;
+  key.setPhase(0);
+  auto itm = map_.map_cfind(key);
+  if(itm != map_.map_cend() && itm->clr() == map_.getClr()) {
+    return itm->val().v_/StringT::power(p.phase());
+  }
+  return 0;
+}
+
+template<std::size_t W>
+std::size_t
+PauliSum<W>::
+prune(double tol) {
+  /* erases the terms with |c| <= tol, returns how many */
+  return map_.erase_if([&](const StringT&, const V& v)
+    {return std::abs(v.v_) <= tol;});
+}
+
+template<std::size_t W>
+std::vector<std::pair<typename PauliSum<W>::StringT,
+  typename PauliSum<W>::Value>>
+PauliSum<W>::
+terms() const {
+  /* the live terms, strings of phase 0, in list order */
+  std::vector<std::pair<StringT,Value>> out;
+  for(auto itl = map_.list_cbegin(); itl != map_.list_cend()
+    && itl->clr() == map_.getClr(); itl++) {
+    out.emplace_back(itl->key(), itl->val().v_);
+  }
+  return out;
+}
+
+template<std::size_t W>
+int
+PauliSum<W>::
+trie(const std::vector<std::uint64_t>& mask, std::size_t lo, std::size_t hi,
+  std::vector<Node>& nodes) {
+  /* binary trie over the sorted masks [lo,hi), split on the highest bit
+  where they differ; a leaf is ~g for mask g */
+  if(hi - lo == 1) {return ~int(lo);}
+  unsigned bit = 63 - std::countl_zero(mask[lo] ^ mask[hi-1]);
+  std::size_t mid = std::partition_point(mask.begin() + lo,
+    mask.begin() + hi, [&](std::uint64_t x) {return !((x >> bit) & 1);})
+    - mask.begin();
+  int n = int(nodes.size());
+  nodes.push_back({bit, 0, 0});
+  int lower = trie(mask, lo, mid, nodes);
+  int upper = trie(mask, mid, hi, nodes);
+  nodes[n].lower_ = lower;
+  nodes[n].upper_ = upper;
+  return n;
+}
+
+template<std::size_t W>
+template<class Index>
+bool
+PauliSum<W>::
+toCSR(CompressedMatrix<Index,Value>& csr, std::size_t qubits,
+  unsigned threads, double tol) const {
+  /* the 2^qubits square matrix into csr, for strings acting on the first
+  qubits only, with qubits fewer than the bits of Index; false, and csr
+  unchanged, otherwise.  Entries with |v| <= tol are left out.  Rows are
+  counted, then built, in blocks, one per thread */
+  if(qubits >= 8*sizeof(Index) || qubits >= 64) {return false;}
+  struct Term {std::uint64_t x_; std::uint64_t z_; Value c_;};
+  std::vector<Term> t;
+  for(auto& p : terms()) {
+    if((p.first.x()[0] | p.first.z()[0]) >> qubits) {return false;}
+    for(std::size_t w = 1; w < W; w++) {
+      if(p.first.x()[w] | p.first.z()[w]) {return false;}
+    }
+    t.push_back({p.first.x()[0], p.first.z()[0], p.second});
+  }
+  std::sort(t.begin(), t.end(),
+    [](const Term& a, const Term& b) {return a.x_ < b.x_;});
+  /* groups of terms sharing an X-mask, each one column per row */
+  std::vector<std::size_t> group;
+  std::vector<std::uint64_t> mask;
+  for(std::size_t i = 0; i < t.size(); i++) {
+    if(mask.empty() || mask.back() != t[i].x_) {
+      group.push_back(i);
+      mask.push_back(t[i].x_);
+    }
+  }
+  group.push_back(t.size());
+  auto value = [&](std::size_t g, std::uint64_t c) {
+    Value v = 0;
+    for(std::size_t i = group[g]; i < group[g+1]; i++) {
+      /* a factor +-1, a branch on it would be mispredicted half the
+      time */
+      double sign = 1 - 2*double(std::popcount(t[i].z_ & c) & 1);
+      v += sign*t[i].c_;
+    }
+    return v;
+  };
+  /* a group of one term is |c| on every row; the others are counted
+  with the same sums the second pass takes, so both drop the same */
+  const std::size_t rows = std::size_t(1) << qubits;
+  std::size_t fixed = 0;
+  std::vector<std::size_t> sums;
+  for(std::size_t g = 0; g < mask.size(); g++) {
+    if(group[g+1] - group[g] > 1) {
+      sums.push_back(g);
+    } else if(std::abs(t[group[g]].c_) > tol) {
+      fixed++;
+    }
+  }
+  std::vector<std::size_t> ptr(rows+1, 0);
+  Parallel::forBlocks(rows, threads,
+    [&](std::size_t, std::size_t r0, std::size_t r1) {
+    for(std::size_t r = r0; r < r1; r++) {
+      std::size_t count = fixed;
+      for(auto g : sums) {count += std::abs(value(g, r ^ mask[g])) > tol;}
+      ptr[r+1] = count;
+    }
+  });
+  for(std::size_t r = 0; r < rows; r++) {ptr[r+1] += ptr[r];}
+  /* row r meets the masks in the order of r^x, that is the trie walked
+  with the two halves of each node swapped where r has the node's bit */
+  std::vector<Node> nodes;
+  int root = mask.empty() ? 0 : trie(mask, 0, mask.size(), nodes);
+  std::vector<Index> idx(ptr[rows]);
+  std::vector<Value> val(ptr[rows]);
+  Parallel::forBlocks(rows, threads,
+    [&](std::size_t, std::size_t r0, std::size_t r1) {
+    std::vector<int> stack;
+    for(std::size_t r = r0; r < r1 && !mask.empty(); r++) {
+      std::size_t k = ptr[r];
+      stack.assign(1, root);
+      while(!stack.empty()) {
+        int n = stack.back();
+        stack.pop_back();
+        if(n >= 0) {
+          bool swap = (r >> nodes[n].bit_) & 1;
+          stack.push_back(swap ? nodes[n].lower_ : nodes[n].upper_);
+          stack.push_back(swap ? nodes[n].upper_ : nodes[n].lower_);
+          continue;
+        }
+        std::size_t g = ~n;
+        std::uint64_t c = r ^ mask[g];
+        Value v = value(g, c);
+        if(std::abs(v) > tol) {
+          idx[k] = Index(c);
+          val[k] = v;
+          k++;
+        }
+      }
+    }
+  });
+  csr.assign(std::move(ptr), std::move(idx), std::move(val), Index(rows));
+  return true;
+}
+
+template<std::size_t W>
+std::string
+PauliSum<W>::
+to_string() const {
+  std::string s;
+  for(auto& t : terms()) {
+    s += V(t.second).to_string() + " " + t.first.to_string() + "\n";
+  }
+  return s;
+}
+
+/*
+endend
+*/
+
+#endif
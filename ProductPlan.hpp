@@ -0,0 +1,165 @@
+/*
+  Copyright Benjamin Commeau
+
+Use CamelCase for all names. Start types (such as classes, structs, and typedefs) with a capital letter, other names (functions, variables) with a lowercase letter. You may use an all-lowercase name with underscores if your class closely resembles an external construct (e.g., a standard library construct) named that way.
+
+(1) C++ interfaces are named with a Interface suffix, and abstract base classes with an Abstract prefix.
+(2) Member variables are named with a trailing underscore.
+(3) Accessors for a variable foo_ are named foo() and setFoo().
+(4) Global variables are named with a g_ prefix.
+(5) Static class variables are named with a s_ prefix.
+(6) Global constants are often named with a c_ prefix.
+(7) If the main responsibility of a file is to implement a particular class, then the name of the file should match that class, except for possible abbreviations to avoid repetition in file names (e.g., if all classes within a module start with the module name, omitting or abbreviating the module name is OK). Currently, all source file names are lowercase, but this casing difference should be the only difference.
+
+The rationale for the trailing underscore and the global/static prefixes is that it is immediately clear whether a variable referenced in a method is local to the function or has wider scope, improving the readability of the code.
+*/
+
+#include <algorithm>
+#include <complex>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "Parallel.hpp"
+/* //////////////////////////////////////////////////////////////
+Class Definition
+
+Symbolic/numeric split of C += s*L*R.  The symbolic pass records, for
+every structural nonzero c of C, the (a,b) value pairs that contribute
+to it, as pointers into the nodes of L, R and C.  The numeric pass only
+replays the complex multiply-adds, in the same order as the Gustavson
+product, so it needs no lookups and no allocation.  Either operand may
+be read conjugated, for products with adjoints.  A plan is valid for
+as long as no entry of L, R or C is inserted, erased or cleared.
+*/ //////////////////////////////////////////////////////////////
+#ifndef PRODUCT_PLAN_HPP
+#define PRODUCT_PLAN_HPP
+template<class Index, class Value>
+class ProductPlan {
+ public:
+  /* //////////////////////////////////////////////////////////////
+  Entry of an operand, pointing at the stored value
+  */ //////////////////////////////////////////////////////////////
+  struct Operand {
+    Index x_; Index y_; const Value* v_;
+    Operand() {}
+    Operand(const Index& x, const Index& y, const Value* v) :
+      x_(x), y_(y), v_(v) {}
+    bool operator <(const Operand& o) const {
+      return x_ != o.x_ ? x_ < o.x_ : y_ < o.y_;
+    }
+  };
+  /* //////////////////////////////////////////////////////////////
+  Implicit Methods
+  */ //////////////////////////////////////////////////////////////
+  template<class Pattern>
+  void symbolic(std::vector<Operand>& left, std::vector<Operand>& right,
+    Pattern pattern, bool conjLeft = false, bool conjRight = false);
+  void numeric(const Value& s, unsigned threads = 1) const;
+  void clear();
+  std::size_t size() const {return c_.size();}
+  std::size_t flops() const {return a_.size();}
+ private:
+  static Value conjugate(const Value& v) {
+    if constexpr(std::is_arithmetic_v<Value>) {return v;}
+    else {return std::conj(v);}
+  }
+  template<class ReadA, class ReadB>
+  void replay(const Value& s, unsigned threads, ReadA readA,
+    ReadB readB) const;
+  bool conj_left_ = false;
+  bool conj_right_ = false;
+  std::vector<Value*> c_;
+  std::vector<std::size_t> ptr_; // c_[i] sums pairs [ptr_[i],ptr_[i+1])
+  std::vector<const Value*> a_;
+  std::vector<const Value*> b_;
+};
+
+/* //////////////////////////////////////////////////////////////
+Explicit Methods
+*/ //////////////////////////////////////////////////////////////
+
+template<class Index, class Value>
+void
+ProductPlan<Index, Value>::
+clear() {
+  c_.clear(); ptr_.clear(); a_.clear(); b_.clear();
+}
+
+template<class Index, class Value>
+template<class Pattern>
+void
+ProductPlan<Index, Value>::
+symbolic(std::vector<Operand>& left, std::vector<Operand>& right,
+  Pattern pattern, bool conjLeft, bool conjRight) {
+  /* pattern(x,y) creates the entry (x,y) of C and returns its value */
+  clear();
+  conj_left_ = conjLeft;
+  conj_right_ = conjRight;
+  std::sort(left.begin(), left.end());
+  std::sort(right.begin(), right.end());
+  struct Term {
+    Index y_; const Value* a_; const Value* b_;
+    bool operator <(const Term& t) const {return y_ < t.y_;}
+  };
+  std::vector<Term> terms;
+  auto iL = left.begin();
+  while(iL != left.end()) {
+    Index x = iL->x_;
+    terms.clear();
+    auto iR = right.begin();
+    for(; iL != left.end() && iL->x_ == x; iL++) {
+      iR = std::lower_bound(iR, right.end(), Operand(iL->y_, 0, nullptr));
+      for(auto it = iR; it != right.end() && it->x_ == iL->y_; it++) {
+        terms.push_back(Term{it->y_, iL->v_, it->v_});
+      }
+    }
+    /* stable, so each sum keeps the increasing-k order of Gustavson */
+    std::stable_sort(terms.begin(), terms.end());
+    for(std::size_t i = 0; i < terms.size(); i++) {
+      if(i == 0 || terms[i].y_ != terms[i-1].y_) {
+        ptr_.push_back(a_.size());
+        c_.push_back(pattern(x, terms[i].y_));
+      }
+      a_.push_back(terms[i].a_);
+      b_.push_back(terms[i].b_);
+    }
+  }
+  ptr_.push_back(a_.size());
+}
+
+template<class Index, class Value>
+void
+ProductPlan<Index, Value>::
+numeric(const Value& s, unsigned threads) const {
+  /* one instance of the loop per conjugation, none tests per term */
+  auto plain = [](const Value* v) {return *v;};
+  auto conj = [](const Value* v) {return conjugate(*v);};
+  if(conj_left_ && conj_right_) {replay(s, threads, conj, conj);}
+  else if(conj_left_) {replay(s, threads, conj, plain);}
+  else if(conj_right_) {replay(s, threads, plain, conj);}
+  else {replay(s, threads, plain, plain);}
+}
+
+template<class Index, class Value>
+template<class ReadA, class ReadB>
+void
+ProductPlan<Index, Value>::
+replay(const Value& s, unsigned threads, ReadA readA, ReadB readB) const {
+  Parallel::forBlocks(c_.size(), threads,
+    [&](std::size_t, std::size_t i0, std::size_t i1) {
+    Value v;
+    for(std::size_t i = i0; i < i1; i++) {
+      v = readA(a_[ptr_[i]]) * readB(b_[ptr_[i]]);
+      for(std::size_t j = ptr_[i] + 1; j < ptr_[i+1]; j++) {
+        v += readA(a_[j]) * readB(b_[j]);
+      }
+      *c_[i] += s*v;
+    }
+  });
+}
+
+/*
+endend
+*/
+
+#endif
@@ -0,0 +1,128 @@
+/*
+  Copyright Benjamin Commeau
+
+Use CamelCase for all names. Start types (such as classes, structs, and typedefs) with a capital letter, other names (functions, variables) with a lowercase letter. You may use an all-lowercase name with underscores if your class closely resembles an external construct (e.g., a standard library construct) named that way.
+
+(1) C++ interfaces are named with a Interface suffix, and abstract base classes with an Abstract prefix.
+(2) Member variables are named with a trailing underscore.
+(3) Accessors for a variable foo_ are named foo() and setFoo().
+(4) Global variables are named with a g_ prefix.
+(5) Static class variables are named with a s_ prefix.
+(6) Global constants are often named with a c_ prefix.
+(7) If the main responsibility of a file is to implement a particular class, then the name of the file should match that class, except for possible abbreviations to avoid repetition in file names (e.g., if all classes within a module start with the module name, omitting or abbreviating the module name is OK). Currently, all source file names are lowercase, but this casing difference should be the only difference.
+
+The rationale for the trailing underscore and the global/static prefixes is that it is immediately clear whether a variable referenced in a method is local to the function or has wider scope, improving the readability of the code.
+*/
+
+#include <cmath>
+#include <list>
+#include <set>
+#include <utility>
+#include <vector>
+#include "SlabAllocator.hpp"
+/* //////////////////////////////////////////////////////////////
+Class Definition
+
+Ordered index of Map: a red-black tree of list iterators ("handles")
+compared through the keys stored in the list nodes.  This is the
+original layout of Map and its default index.
+
+Every index of Map provides the same interface:
+  iterator          bidirectional, *it is the Handle of the entry
+  begin() end()
+  find(key) lower_bound(key) upper_bound(key)
+  insert(key, handle)          -> std::pair<iterator,bool>
+  insert(hint, key, handle)    -> iterator, hint from lower_bound(key)
+  insert_sorted(items)         items of (key, handle) sorted by key,
+                               none of them already indexed
+  erase(it)                    -> iterator following it
+  clear() size() empty()
+  c_ordered                    true when walking begin() to end() is cheap
+  c_stable                     true when erase(it) leaves other iterators valid
+"key" is always the key stored in the node of "handle".
+*/ //////////////////////////////////////////////////////////////
+#ifndef SET_INDEX_HPP
+#define SET_INDEX_HPP
+template<class Key, class ListT, class Compare>
+class SetIndex {
+ public:
+  typedef typename ListT::iterator Handle;
+  struct LessHandle {
+    /* also compares handles with keys, so lookups need no probe node */
+    typedef void is_transparent;
+    Compare compare_ = Compare();
+    bool operator() (const Handle& lhs, const Handle& rhs) const {
+      return compare_(lhs->key(), rhs->key());
+    }
+    bool operator() (const Handle& lhs, const Key& rhs) const {
+      return compare_(lhs->key(), rhs);
+    }
+    bool operator() (const Key& lhs, const Handle& rhs) const {
+      return compare_(lhs, rhs->key());
+    }
+  };
+  typedef std::set<Handle,LessHandle,SlabAllocator<Handle>> SetT;
+  typedef typename SetT::iterator iterator;
+  static constexpr bool c_ordered = true;
+  static constexpr bool c_stable = true;
+  /* //////////////////////////////////////////////////////////////
+  Implicit Methods
+  */ //////////////////////////////////////////////////////////////
+  iterator begin() const {return set_.begin();}
+  iterator end() const {return set_.end();}
+  iterator find(const Key& key) const {return set_.find(key);}
+  iterator lower_bound(const Key& key) const {return set_.lower_bound(key);}
+  iterator upper_bound(const Key& key) const {return set_.upper_bound(key);}
+  std::pair<iterator,bool> insert(const Key& key, const Handle& h);
+  iterator insert(iterator hint, const Key& key, const Handle& h);
+  void insert_sorted(const std::vector<std::pair<Key,Handle>>& items);
+  iterator erase(iterator it) {return set_.erase(it);}
+  void clear() {SetT().swap(set_);} // also gives back the node slabs
+  std::size_t size() const {return set_.size();}
+  bool empty() const {return set_.empty();}
+ private:
+  SetT set_;
+  Compare compare_ = Compare();
+};
+
+/* //////////////////////////////////////////////////////////////
+Explicit Methods
+*/ //////////////////////////////////////////////////////////////
+
+template<class Key, class ListT, class Compare>
+std::pair<typename SetIndex<Key, ListT, Compare>::iterator, bool>
+SetIndex<Key, ListT, Compare>::
+insert(const Key&, const Handle& h) {
+  return set_.insert(h);
+}
+
+template<class Key, class ListT, class Compare>
+typename SetIndex<Key, ListT, Compare>::
+iterator
+SetIndex<Key, ListT, Compare>::
+insert(iterator hint, const Key&, const Handle& h) {
+  return set_.insert(hint, h);
+}
+
+template<class Key, class ListT, class Compare>
+void
+SetIndex<Key, ListT, Compare>::
+insert_sorted(const std::vector<std::pair<Key,Handle>>& items) {
+  /* a few items are looked up, many are merged in one walk where each
+  insert lands right before its hint */
+  if(items.size()*std::log2(double(set_.size()) + 1) < set_.size()) {
+    for(auto& item : items) {set_.insert(item.second);}
+    return;
+  }
+  auto it = set_.begin();
+  for(auto& item : items) {
+    while(it != set_.end() && compare_((*it)->key(), item.first)) {it++;}
+    set_.insert(it, item.second);
+  }
+}
+
+/*
+endend
+*/
+
+#endif
@@ -0,0 +1,291 @@
+/*
+  Copyright Benjamin Commeau
+
+Use CamelCase for all names. Start types (such as classes, structs, and typedefs) with a capital letter, other names (functions, variables) with a lowercase letter. You may use an all-lowercase name with underscores if your class closely resembles an external construct (e.g., a standard library construct) named that way.
+
+(1) C++ interfaces are named with a Interface suffix, and abstract base classes with an Abstract prefix.
+(2) Member variables are named with a trailing underscore.
+(3) Accessors for a variable foo_ are named foo() and setFoo().
+(4) Global variables are named with a g_ prefix.
+(5) Static class variables are named with a s_ prefix.
+(6) Global constants are often named with a c_ prefix.
+(7) If the main responsibility of a file is to implement a particular class, then the name of the file should match that class, except for possible abbreviations to avoid repetition in file names (e.g., if all classes within a module start with the module name, omitting or abbreviating the module name is OK). Currently, all source file names are lowercase, but this casing difference should be the only difference.
+
+The rationale for the trailing underscore and the global/static prefixes is that it is immediately clear whether a variable referenced in a method is local to the function or has wider scope, improving the readability of the code.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+#include "Map.hpp"
+#include "Parallel.hpp"
+/* //////////////////////////////////////////////////////////////
+Class Definition
+
+Map split into shards, each with its own lock and its own generation
+counter, so many threads can accumulate into one map.  Keys go to a
+shard by hash, or by range when bounds are given: shard i then holds
+the keys in [bounds[i-1], bounds[i]).  Iteration merges the shards in
+key order and must not run next to a writer.
+*/ //////////////////////////////////////////////////////////////
+#ifndef SHARDED_MAP_HPP
+#define SHARDED_MAP_HPP
+template<class Key, class Val, class Compare = std::less<Key>,
+  template<class, class, class> class Index = SetIndex,
+  class Hash = std::hash<Key>>
+class ShardedMap {
+ public:
+  typedef Map<Key, Val, Compare, Index> MapT;
+  /* //////////////////////////////////////////////////////////////
+  Shard, on its own cache lines so locks do not share a line
+  */ //////////////////////////////////////////////////////////////
+  struct alignas(64) Shard {
+    std::mutex mutex_;
+    MapT map_;
+  };
+  /* //////////////////////////////////////////////////////////////
+  Ordered iteration over the live entries of all shards
+  */ //////////////////////////////////////////////////////////////
+  class ConstIterator {
+   public:
+    ConstIterator() {}
+    Key key() const {return cur_[min_]->key();}
+    Val val() const {return cur_[min_]->val();}
+    std::size_t shard() const {return min_;}
+    ConstIterator& operator++() {
+      ++cur_[min_];
+      skip(min_);
+      pick();
+      return *this;
+    }
+    ConstIterator operator++(int)
+      {ConstIterator tmp = *this; ++(*this); return tmp;}
+    friend bool operator== (const ConstIterator& a, const ConstIterator& b) {
+      if(a.done() || b.done()) {return a.done() == b.done();}
+      return a.min_ == b.min_ && a.cur_[a.min_] == b.cur_[b.min_];
+    }
+    friend bool operator!= (const ConstIterator& a, const ConstIterator& b)
+      {return !(a == b);}
+   private:
+    friend class ShardedMap;
+    typedef typename MapT::ConstMapIterator ConstMapIterator;
+    bool done() const {return min_ == cur_.size();}
+    void skip(std::size_t i);
+    void pick();
+    mutable std::vector<ConstMapIterator> cur_;
+    mutable std::vector<ConstMapIterator> end_;
+    std::vector<typename MapT::Clr> clr_;
+    std::size_t min_ = 0;
+    Compare compare_ = Compare();
+  };
+  /* //////////////////////////////////////////////////////////////
+  Implicit Methods
+  */ //////////////////////////////////////////////////////////////
+  ShardedMap(std::size_t shards = Parallel::hardware());
+  ShardedMap(const std::vector<Key>& bounds);
+  std::size_t shards() const {return shards_.size();}
+  std::size_t shardOf(const Key& key) const;
+  MapT& shard(std::size_t i) {return shards_[i]->map_;}
+  const MapT& shard(std::size_t i) const {return shards_[i]->map_;}
+  bool try_emplace(const Key& key, const Val& val);
+  template<class Combine>
+  bool upsert(const Key& key, const Val& val, Combine combine);
+  template<class Combine>
+  void upsert_range(std::span<const std::pair<Key,Val>> items,
+    Combine combine);
+  bool find(const Key& key, Val& val) const;
+  void clear();
+  void hard_clear();
+  std::size_t countLive() const;
+  ConstIterator cbegin() const;
+  ConstIterator cend() const {return ConstIterator();}
+ private:
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::vector<Key> bounds_; // empty when sharded by hash
+  Hash hash_ = Hash();
+  Compare compare_ = Compare();
+};
+
+/* //////////////////////////////////////////////////////////////
+Explicit Methods
+*/ //////////////////////////////////////////////////////////////
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class Hash>
+ShardedMap<Key, Val, Compare, Index, Hash>::
+ShardedMap(std::size_t shards) {
+  for(std::size_t i = 0; i < std::max<std::size_t>(1, shards); i++) {
+    shards_.push_back(std::make_unique<Shard>());
+  }
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class Hash>
+ShardedMap<Key, Val, Compare, Index, Hash>::
+ShardedMap(const std::vector<Key>& bounds) : bounds_(bounds) {
+  /* bounds sorted by Compare */
+  for(std::size_t i = 0; i <= bounds_.size(); i++) {
+    shards_.push_back(std::make_unique<Shard>());
+  }
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class Hash>
+std::size_t
+ShardedMap<Key, Val, Compare, Index, Hash>::
+shardOf(const Key& key) const {
+  if(!bounds_.empty()) {
+    return std::upper_bound(bounds_.begin(), bounds_.end(), key, compare_)
+      - bounds_.begin();
+  }
+  /* mixed apart from the multiplicative hash inside each shard */
+  std::uint64_t h = hash_(key);
+  h ^= h >> 33; h *= UINT64_C(0xff51afd7ed558ccd); h ^= h >> 33;
+  return h % shards_.size();
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class Hash>
+bool
+ShardedMap<Key, Val, Compare, Index, Hash>::
+try_emplace(const Key& key, const Val& val) {
+  Shard& s = *shards_[shardOf(key)];
+  std::lock_guard<std::mutex> lock(s.mutex_);
+  return s.map_.try_emplace(key, val).IsValid();
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class Hash>
+template<class Combine>
+bool
+ShardedMap<Key, Val, Compare, Index, Hash>::
+upsert(const Key& key, const Val& val, Combine combine) {
+  Shard& s = *shards_[shardOf(key)];
+  std::lock_guard<std::mutex> lock(s.mutex_);
+  return s.map_.upsert(key, val, combine).IsValid();
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class Hash>
+template<class Combine>
+void
+ShardedMap<Key, Val, Compare, Index, Hash>::
+upsert_range(std::span<const std::pair<Key,Val>> items, Combine combine) {
+  /* items are bucketed by shard first, so each lock is taken once */
+  std::vector<std::vector<std::size_t>> bucket(shards_.size());
+  for(std::size_t i = 0; i < items.size(); i++) {
+    bucket[shardOf(items[i].first)].push_back(i);
+  }
+  for(std::size_t b = 0; b < bucket.size(); b++) {
+    if(bucket[b].empty()) {continue;}
+    Shard& s = *shards_[b];
+    std::lock_guard<std::mutex> lock(s.mutex_);
+    for(auto i : bucket[b]) {
+      s.map_.upsert(items[i].first, items[i].second, combine);
+    }
+  }
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class Hash>
+bool
+ShardedMap<Key, Val, Compare, Index, Hash>::
+find(const Key& key, Val& val) const {
+  /* val is set when key is live */
+  Shard& s = *shards_[shardOf(key)];
+  std::lock_guard<std::mutex> lock(s.mutex_);
+  auto itm = s.map_.map_cfind(key);
+  if(itm == s.map_.map_cend() || itm->clr() != s.map_.getClr()) {
+    return false;
+  }
+  val = itm->val();
+  return true;
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class Hash>
+void
+ShardedMap<Key, Val, Compare, Index, Hash>::
+clear() {
+  for(auto& s : shards_) {
+    std::lock_guard<std::mutex> lock(s->mutex_);
+    s->map_.clear();
+  }
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class Hash>
+void
+ShardedMap<Key, Val, Compare, Index, Hash>::
+hard_clear() {
+  for(auto& s : shards_) {
+    std::lock_guard<std::mutex> lock(s->mutex_);
+    s->map_.hard_clear();
+  }
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class Hash>
+std::size_t
+ShardedMap<Key, Val, Compare, Index, Hash>::
+countLive() const {
+  std::size_t count = 0;
+  for(auto& s : shards_) {
+    std::lock_guard<std::mutex> lock(s->mutex_);
+    count += s->map_.countLive();
+  }
+  return count;
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class Hash>
+typename ShardedMap<Key, Val, Compare, Index, Hash>::
+ConstIterator
+ShardedMap<Key, Val, Compare, Index, Hash>::
+cbegin() const {
+  ConstIterator it;
+  for(auto& s : shards_) {
+    it.cur_.push_back(s->map_.map_cbegin());
+    it.end_.push_back(s->map_.map_cend());
+    it.clr_.push_back(s->map_.getClr());
+  }
+  for(std::size_t i = 0; i < it.cur_.size(); i++) {it.skip(i);}
+  it.pick();
+  return it;
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class Hash>
+void
+ShardedMap<Key, Val, Compare, Index, Hash>::ConstIterator::
+skip(std::size_t i) {
+  /* steps shard i over stale entries */
+  while(cur_[i] != end_[i] && cur_[i]->clr() != clr_[i]) {++cur_[i];}
+}
+
+template<class Key, class Val, class Compare,
+  template<class, class, class> class Index, class Hash>
+void
+ShardedMap<Key, Val, Compare, Index, Hash>::ConstIterator::
+pick() {
+  /* the shard holding the smallest key, shards are few */
+  min_ = cur_.size();
+  for(std::size_t i = 0; i < cur_.size(); i++) {
+    if(cur_[i] == end_[i]) {continue;}
+    if(min_ == cur_.size() || compare_(cur_[i]->key(), cur_[min_]->key())) {
+      min_ = i;
+    }
+  }
+  if(min_ == cur_.size()) {cur_.clear(); end_.clear(); min_ = 0;}
+}
+
+/*
+endend
+*/
+
+#endif
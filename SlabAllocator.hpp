@@ -0,0 +1,229 @@
+/*
+  Copyright Benjamin Commeau
+
+Use CamelCase for all names. Start types (such as classes, structs, and typedefs) with a capital letter, other names (functions, variables) with a lowercase letter. You may use an all-lowercase name with underscores if your class closely resembles an external construct (e.g., a standard library construct) named that way.
+
+(1) C++ interfaces are named with a Interface suffix, and abstract base classes with an Abstract prefix.
+(2) Member variables are named with a trailing underscore.
+(3) Accessors for a variable foo_ are named foo() and setFoo().
+(4) Global variables are named with a g_ prefix.
+(5) Static class variables are named with a s_ prefix.
+(6) Global constants are often named with a c_ prefix.
+(7) If the main responsibility of a file is to implement a particular class, then the name of the file should match that class, except for possible abbreviations to avoid repetition in file names (e.g., if all classes within a module start with the module name, omitting or abbreviating the module name is OK). Currently, all source file names are lowercase, but this casing difference should be the only difference.
+
+The rationale for the trailing underscore and the global/static prefixes is that it is immediately clear whether a variable referenced in a method is local to the function or has wider scope, improving the readability of the code.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <vector>
+/* //////////////////////////////////////////////////////////////
+Class Definition
+
+Node allocator for the std::list and std::set inside Map.  Single nodes
+are carved out of contiguous slabs and recycled through a free list,
+so building a container costs one malloc per slab instead of one per
+node, and nodes allocated together sit on consecutive cache lines.
+Each container gets its own arena with one pool per node size: rebinding
+shares the arena, and copies of a container do not share an arena.
+trim() gives the slabs whose nodes are all free back to the system.
+*/ //////////////////////////////////////////////////////////////
+#ifndef SLAB_ALLOCATOR_HPP
+#define SLAB_ALLOCATOR_HPP
+class SlabPool {
+ public:
+  static constexpr std::size_t c_slabBytes = 1 << 16;
+  SlabPool(std::size_t size, std::size_t align);
+  SlabPool(const SlabPool&) = delete;
+  SlabPool& operator=(const SlabPool&) = delete;
+  ~SlabPool();
+  void* allocate();
+  void deallocate(void* p);
+  std::size_t trim();
+  std::size_t slabs() const {return slabs_.size();}
+  std::size_t capacity() const {return slabs_.size()*chunks_;}
+ private:
+  struct Free {Free* next_;};
+  std::size_t size_;
+  std::size_t align_;
+  std::size_t chunks_;
+  Free* free_ = nullptr;
+  char* cursor_ = nullptr;
+  char* end_ = nullptr;
+  std::vector<char*> slabs_;
+};
+
+class SlabArena {
+ public:
+  SlabPool& pool(std::size_t size, std::size_t align);
+  std::size_t trim();
+  std::size_t slabs() const;
+ private:
+  struct Entry {
+    std::size_t size_; std::size_t align_; std::unique_ptr<SlabPool> pool_;
+  };
+  std::vector<Entry> pools_;
+};
+
+template<class U>
+class SlabAllocator {
+  template<class W> friend class SlabAllocator;
+ public:
+  using value_type = U;
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+  using is_always_equal = std::false_type;
+  SlabAllocator() : arena_(std::make_shared<SlabArena>()),
+    pool_(&arena_->pool(sizeof(U), alignof(U))) {}
+  SlabAllocator(const SlabAllocator&) = default;
+  template<class W>
+  SlabAllocator(const SlabAllocator<W>& rhs) : arena_(rhs.arena_),
+    pool_(&arena_->pool(sizeof(U), alignof(U))) {}
+  SlabAllocator& operator=(const SlabAllocator&) = default;
+  U* allocate(std::size_t n) {
+    if(n == 1) {return static_cast<U*>(pool_->allocate());}
+    return static_cast<U*>(::operator new(n*sizeof(U)));
+  }
+  void deallocate(U* p, std::size_t n) {
+    if(n == 1) {pool_->deallocate(p);} else {::operator delete(p);}
+  }
+  SlabAllocator select_on_container_copy_construction() const {
+    return SlabAllocator();
+  }
+  SlabPool& pool() const {return *pool_;}
+  SlabArena& arena() const {return *arena_;}
+  friend bool operator== (const SlabAllocator& a, const SlabAllocator& b)
+    {return a.arena_ == b.arena_;}
+  friend bool operator!= (const SlabAllocator& a, const SlabAllocator& b)
+    {return a.arena_ != b.arena_;}
+ private:
+  std::shared_ptr<SlabArena> arena_;
+  SlabPool* pool_;
+};
+
+/* //////////////////////////////////////////////////////////////
+Explicit Methods
+*/ //////////////////////////////////////////////////////////////
+
+SlabPool::
+SlabPool(std::size_t size, std::size_t align) {
+  align_ = std::max(align, alignof(Free));
+  size_ = std::max(size, sizeof(Free));
+  size_ = ((size_ + align_ - 1)/align_)*align_;
+  chunks_ = std::max<std::size_t>(1, c_slabBytes/size_);
+}
+
+SlabPool::
+~SlabPool() {
+  for(auto slab : slabs_) {
+    ::operator delete(slab, std::align_val_t(align_));
+  }
+}
+
+void*
+SlabPool::
+allocate() {
+  if(free_ != nullptr) {
+    Free* p = free_;
+    free_ = free_->next_;
+    return p;
+  }
+  if(cursor_ == end_) {
+    slabs_.push_back(static_cast<char*>(
+      ::operator new(chunks_*size_, std::align_val_t(align_))));
+    cursor_ = slabs_.back();
+    end_ = cursor_ + chunks_*size_;
+  }
+  void* p = cursor_;
+  cursor_ += size_;
+  return p;
+}
+
+void
+SlabPool::
+deallocate(void* p) {
+  Free* f = static_cast<Free*>(p);
+  f->next_ = free_;
+  free_ = f;
+}
+
+std::size_t
+SlabPool::
+trim() {
+  /* returns the number of slabs released */
+  std::vector<char*> sorted(slabs_);
+  std::sort(sorted.begin(), sorted.end(), std::less<char*>());
+  auto slabOf = [&](void* p) {
+    return std::upper_bound(sorted.begin(), sorted.end(),
+      static_cast<char*>(p), std::less<char*>()) - sorted.begin() - 1;
+  };
+  std::vector<std::size_t> free(sorted.size(), 0);
+  for(Free* f = free_; f != nullptr; f = f->next_) {free[slabOf(f)]++;}
+  if(!slabs_.empty()) {
+    /* chunks past the cursor of the last slab were never handed out */
+    free[slabOf(slabs_.back())] += (end_ - cursor_)/size_;
+  }
+  std::vector<bool> release(sorted.size());
+  std::size_t count = 0;
+  for(std::size_t i = 0; i < sorted.size(); i++) {
+    release[i] = (free[i] == chunks_);
+    if(release[i]) {count++;}
+  }
+  if(count == 0) {return 0;}
+  Free** link = &free_;
+  for(Free* f = free_; f != nullptr; f = f->next_) {
+    if(!release[slabOf(f)]) {*link = f; link = &f->next_;}
+  }
+  *link = nullptr;
+  if(!slabs_.empty() && release[slabOf(slabs_.back())]) {
+    cursor_ = nullptr; end_ = nullptr;
+  }
+  std::vector<char*> kept;
+  for(auto slab : slabs_) {
+    if(release[slabOf(slab)]) {
+      ::operator delete(slab, std::align_val_t(align_));
+    } else {
+      kept.push_back(slab);
+    }
+  }
+  slabs_.swap(kept);
+  return count;
+}
+
+SlabPool&
+SlabArena::
+pool(std::size_t size, std::size_t align) {
+  for(auto& e : pools_) {
+    if(e.size_ == size && e.align_ == align) {return *e.pool_;}
+  }
+  pools_.push_back(Entry{size, align, std::make_unique<SlabPool>(size, align)});
+  return *pools_.back().pool_;
+}
+
+std::size_t
+SlabArena::
+trim() {
+  std::size_t count = 0;
+  for(auto& e : pools_) {count += e.pool_->trim();}
+  return count;
+}
+
+std::size_t
+SlabArena::
+slabs() const {
+  std::size_t count = 0;
+  for(auto& e : pools_) {count += e.pool_->slabs();}
+  return count;
+}
+
+/*
+endend
+*/
+
+#endif
@@ -0,0 +1,261 @@
+/*
+  Copyright Benjamin Commeau
+
+Use CamelCase for all names. Start types (such as classes, structs, and typedefs) with a capital letter, other names (functions, variables) with a lowercase letter. You may use an all-lowercase name with underscores if your class closely resembles an external construct (e.g., a standard library construct) named that way.
+
+(1) C++ interfaces are named with a Interface suffix, and abstract base classes with an Abstract prefix.
+(2) Member variables are named with a trailing underscore.
+(3) Accessors for a variable foo_ are named foo() and setFoo().
+(4) Global variables are named with a g_ prefix.
+(5) Static class variables are named with a s_ prefix.
+(6) Global constants are often named with a c_ prefix.
+(7) If the main responsibility of a file is to implement a particular class, then the name of the file should match that class, except for possible abbreviations to avoid repetition in file names (e.g., if all classes within a module start with the module name, omitting or abbreviating the module name is OK). Currently, all source file names are lowercase, but this casing difference should be the only difference.
+
+The rationale for the trailing underscore and the global/static prefixes is that it is immediately clear whether a variable referenced in a method is local to the function or has wider scope, improving the readability of the code.
+*/
+
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "PauliString.hpp"
+/* //////////////////////////////////////////////////////////////
+Class Definition
+
+Collects like terms of a stream of weighted Pauli strings, as produced
+by the pairwise products of two sums.  Each string is packed as its X
+and Z words, its phase folded into the coefficient, and kept inline
+with that coefficient in an open-addressing table with linear probing,
+so merging a term costs about one cache miss and no tree descent.
+Pending terms wait in a ring of c_batch entries, their slots prefetched
+when they enter it and merged c_batch terms later, so the misses of
+consecutive terms overlap.
+Strings on at most c_dense qubits, when the collector is told so, skip
+the hashing: their coefficients sit in a dense array of 4^qubits
+entries indexed by (x << qubits) | z, which is also their order, and
+merging a term is one add.
+sorted() returns the canonical sum: the terms in the order of
+PauliString, those with |c| <= tol() dropped.
+*/ //////////////////////////////////////////////////////////////
+#ifndef TERM_COLLECTOR_HPP
+#define TERM_COLLECTOR_HPP
+template<std::size_t W = 1>
+class TermCollector {
+ public:
+  typedef PauliString<W> StringT;
+  typedef typename StringT::Bits Bits;
+  typedef std::complex<double> Value;
+  struct Slot {
+    Bits x_; Bits z_; Value v_; bool used_ = false;
+  };
+  static constexpr std::size_t c_batch = 16;
+  static constexpr std::size_t c_dense = 10;
+  /* //////////////////////////////////////////////////////////////
+  Implicit Methods
+  */ //////////////////////////////////////////////////////////////
+  TermCollector(double tol = 0, std::size_t qubits = StringT::c_qubits);
+  double tol() const {return tol_;}
+  void setTol(double tol) {tol_ = tol;}
+  bool dense() const {return qubits_ <= c_dense;}
+  void reserve(std::size_t n);
+  void add(const StringT& p, const Value& c)
+    {add(p.x(), p.z(), StringT::rotate(c, p.phase()));}
+  void add(const Bits& x, const Bits& z, const Value& c);
+  void flush();
+  std::size_t size();
+  void clear();
+  std::vector<std::pair<StringT,Value>> sorted();
+ private:
+  struct Pending {
+    Bits x_; Bits z_; Value v_; std::size_t i_;
+  };
+  std::size_t bucket(const Bits& x, const Bits& z) const;
+  void merge(const Pending& t);
+  void rehash(std::size_t capacity);
+  std::vector<Slot> slots_;
+  std::size_t size_ = 0;
+  std::size_t mask_ = 0;
+  unsigned shift_ = 64;
+  std::array<Pending, c_batch> pending_;
+  std::size_t count_ = 0; // terms in pending_
+  std::size_t next_ = 0; // entry of pending_ the next term takes
+  std::vector<Value> dense_; // 4^qubits_ coefficients when dense()
+  std::size_t qubits_;
+  double tol_ = 0;
+};
+
+/* //////////////////////////////////////////////////////////////
+Explicit Methods
+*/ //////////////////////////////////////////////////////////////
+
+template<std::size_t W>
+TermCollector<W>::
+TermCollector(double tol, std::size_t qubits) :
+  qubits_(W == 1 ? qubits : StringT::c_qubits), tol_(tol) {
+  /* strings with no bit at or above qubits */
+  if(dense()) {dense_.assign(std::size_t(1) << (2*qubits_), Value(0));}
+}
+
+template<std::size_t W>
+std::size_t
+TermCollector<W>::
+bucket(const Bits& x, const Bits& z) const {
+  std::uint64_t h = 0;
+  for(std::size_t w = 0; w < W; w++) {
+    h = (h ^ x[w])*UINT64_C(0x9E3779B97F4A7C15);
+    h = (h ^ z[w])*UINT64_C(0x9E3779B97F4A7C15);
+    h ^= h >> 29;
+  }
+  return (h*UINT64_C(0x9E3779B97F4A7C15)) >> shift_;
+}
+
+template<std::size_t W>
+void
+TermCollector<W>::
+merge(const Pending& t) {
+  /* adds t.v_ into the slot of (t.x_,t.z_), probing from bucket t.i_ */
+  std::size_t i = t.i_;
+  while(slots_[i].used_) {
+    if(slots_[i].x_ == t.x_ && slots_[i].z_ == t.z_) {
+      slots_[i].v_ += t.v_;
+      return;
+    }
+    i = (i + 1) & mask_;
+  }
+  slots_[i].x_ = t.x_;
+  slots_[i].z_ = t.z_;
+  slots_[i].v_ = t.v_;
+  slots_[i].used_ = true;
+  size_++;
+}
+
+template<std::size_t W>
+void
+TermCollector<W>::
+rehash(std::size_t capacity) {
+  std::vector<Slot> old(capacity);
+  old.swap(slots_);
+  mask_ = capacity - 1;
+  shift_ = 64;
+  while(capacity > 1) {capacity >>= 1; shift_--;}
+  size_ = 0;
+  for(auto& s : old) {
+    if(s.used_) {merge({s.x_, s.z_, s.v_, bucket(s.x_, s.z_)});}
+  }
+}
+
+template<std::size_t W>
+void
+TermCollector<W>::
+reserve(std::size_t n) {
+  /* room for n distinct terms at a load factor of at most 3/4 */
+  if(dense()) {return;}
+  flush();
+  std::size_t capacity = std::max<std::size_t>(16, slots_.size());
+  while(4*(n + c_batch) > 3*capacity) {capacity *= 2;}
+  if(capacity > slots_.size()) {rehash(capacity);}
+}
+
+template<std::size_t W>
+void
+TermCollector<W>::
+add(const Bits& x, const Bits& z, const Value& c) {
+  /* c*X^x Z^z.  The table grows with the ring empty, so the buckets in
+  the ring stay valid until they are merged */
+  if(dense()) {
+    dense_[(x[0] << qubits_) | z[0]] += c;
+    return;
+  }
+  if(4*(size_ + count_ + 1) > 3*slots_.size()) {
+    flush();
+    rehash(std::max<std::size_t>(16, 2*slots_.size()));
+  }
+  Pending& t = pending_[next_];
+  if(count_ == c_batch) {merge(t);} else {count_++;}
+  t.x_ = x;
+  t.z_ = z;
+  t.v_ = c;
+  t.i_ = bucket(x, z);
+#if defined(__GNUC__)
+  /* both ends, a slot may straddle two lines */
+  __builtin_prefetch(&slots_[t.i_], 1);
+  __builtin_prefetch(&slots_[t.i_].used_, 1);
+#endif
+  next_ = (next_ + 1) % c_batch;
+}
+
+template<std::size_t W>
+void
+TermCollector<W>::
+flush() {
+  for(std::size_t k = 0; k < count_; k++) {
+    merge(pending_[(next_ + c_batch - count_ + k) % c_batch]);
+  }
+  count_ = 0;
+}
+
+template<std::size_t W>
+std::size_t
+TermCollector<W>::
+size() {
+  /* distinct strings collected; when dense(), those whose coefficient is
+  not 0 */
+  if(dense()) {
+    return std::count_if(dense_.begin(), dense_.end(),
+      [](const Value& v) {return v != Value(0);});
+  }
+  flush();
+  return size_;
+}
+
+template<std::size_t W>
+void
+TermCollector<W>::
+clear() {
+  /* keeps the table, so the next product of the same size does not
+  grow it again */
+  std::fill(dense_.begin(), dense_.end(), Value(0));
+  for(auto& s : slots_) {s.used_ = false;}
+  size_ = 0;
+  count_ = 0;
+}
+
+template<std::size_t W>
+std::vector<std::pair<typename TermCollector<W>::StringT,
+  typename TermCollector<W>::Value>>
+TermCollector<W>::
+sorted() {
+  /* the collected terms with |c| > tol(), strings of phase 0 in
+  ascending order */
+  std::vector<std::pair<StringT,Value>> out;
+  if(dense()) {
+    for(std::size_t i = 0; i < dense_.size(); i++) {
+      if(std::abs(dense_[i]) > tol_) {
+        Bits x{}; Bits z{};
+        x[0] = i >> qubits_;
+        z[0] = i & ((std::size_t(1) << qubits_) - 1);
+        out.emplace_back(StringT(x, z), dense_[i]);
+      }
+    }
+    return out;
+  }
+  flush();
+  out.reserve(size_);
+  for(auto& s : slots_) {
+    if(s.used_ && std::abs(s.v_) > tol_) {
+      out.emplace_back(StringT(s.x_, s.z_), s.v_);
+    }
+  }
+  std::sort(out.begin(), out.end(),
+    [](const std::pair<StringT,Value>& a, const std::pair<StringT,Value>& b)
+    {return a.first < b.first;});
+  return out;
+}
+
+/*
+endend
+*/
+
+#endif
@@ -7,7 +7,7 @@ run=run.txt
 execo=myexec.o
 > $error
 > $run
-opt="-O3 -std=c++20 -fdiagnostics-show-template-tree -fmessage-length=80"
+opt="-O3 -std=c++20 -pthread -fdiagnostics-show-template-tree -fmessage-length=80"
 g++ $opt -c $script.cpp 2>&1 | tee -a $error
 g++ $opt -o $execo $script.o 2>&1 | tee -a $error
 if [[ -s $error ]] ; then
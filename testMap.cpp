@@ -27,7 +27,9 @@ The rationale for the trailing underscore and the global/static prefixes is that
 #include <cmath>
 #include <string>
 #include <random>
+#include <thread>
 #include "Map.hpp"
+#include "ShardedMap.hpp"
 
 
 class Timer {
@@ -66,7 +68,645 @@ void test_constantness(const Map<K,V>& map) {
   std::cout << "itl->val()=" << itl->val().to_string() << std::endl;
 }
 
+void test_slab_pool() {
+  SlabPool pool(24, 8);
+  bool is_error = false;
+  char* p0 = static_cast<char*>(pool.allocate());
+  char* p1 = static_cast<char*>(pool.allocate());
+  char* p2 = static_cast<char*>(pool.allocate());
+  if(p1 != p0 + 24 || p2 != p1 + 24) {is_error = true;}
+  pool.deallocate(p1);
+  if(pool.allocate() != p1) {is_error = true;}
+  for(int i = 0; i < 10000; i++) {pool.allocate();}
+  if(pool.slabs() != (10003*24)/SlabPool::c_slabBytes + 1) {is_error = true;}
+  SlabPool trimmed(24, 8);
+  std::vector<void*> chunks;
+  for(int i = 0; i < 20000; i++) {chunks.push_back(trimmed.allocate());}
+  for(int i = 1; i < 20000; i++) {trimmed.deallocate(chunks[i]);}
+  trimmed.trim();
+  if(trimmed.slabs() != 1) {is_error = true;}
+  trimmed.deallocate(chunks[0]);
+  trimmed.trim();
+  if(trimmed.slabs() != 0 || trimmed.allocate() == nullptr) {is_error = true;}
+  if(is_error == false) {
+    std::cout << "Passed slab pool test." << std::endl;
+  } else {
+    std::cout << "Failed slab pool test." << std::endl;
+  }
+}
+
+struct N {
+  int k_;
+  N() {}
+  N(const int& k) {k_ = k;}
+  const int& key() const {return k_;}
+};
+
+template<template<class, class, class> class Index>
+void test_index(const std::string& name) {
+  typedef std::list<N> ListN;
+  Index<int, ListN, std::less<int>> tree;
+  std::set<int> ref;
+  ListN nodes;
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<int> key(0, 4000);
+  bool is_error = false;
+  for(int i = 0; i < 40000; i++) {
+    int k = key(gen);
+    if(i % 3 == 2) {
+      auto it = tree.find(k);
+      if((it != tree.end()) != (ref.count(k) == 1)) {is_error = true;}
+      if(it != tree.end()) {tree.erase(it); ref.erase(k);}
+    } else {
+      nodes.push_front(N(k));
+      auto hint = tree.lower_bound(k);
+      bool inserted = tree.insert(k, nodes.begin()).second;
+      if(i % 2 == 0 && inserted) {
+        tree.erase(tree.find(k));
+        tree.insert(tree.lower_bound(k), k, nodes.begin());
+      }
+      if(inserted != ref.insert(k).second) {is_error = true;}
+      if(!inserted && (*tree.insert(hint, k, nodes.begin()))->key() != k) {
+        is_error = true;
+      }
+    }
+  }
+  for(int dense = 1; dense >= 0; dense--) {
+    std::vector<std::pair<int, ListN::iterator>> items;
+    for(int k = dense ? 0 : 1; k <= 4000; k += dense ? 2 : 997) {
+      if(ref.insert(k).second) {
+        nodes.push_front(N(k));
+        items.emplace_back(k, nodes.begin());
+      }
+    }
+    tree.insert_sorted(items);
+  }
+  if(tree.size() != ref.size()) {is_error = true;}
+  auto itr = ref.begin();
+  for(auto it = tree.begin(); it != tree.end(); it++, itr++) {
+    if(itr == ref.end() || (*it)->key() != *itr) {is_error = true; break;}
+  }
+  auto ritr = ref.rbegin();
+  for(auto it = tree.end(); it != tree.begin(); ritr++) {
+    it--;
+    if((*it)->key() != *ritr) {is_error = true; break;}
+  }
+  for(int k = -1; k <= 4001; k++) {
+    auto lb = tree.lower_bound(k); auto rlb = ref.lower_bound(k);
+    auto ub = tree.upper_bound(k); auto rub = ref.upper_bound(k);
+    if((lb == tree.end()) != (rlb == ref.end())) {is_error = true;}
+    if(lb != tree.end() && (*lb)->key() != *rlb) {is_error = true;}
+    if((ub == tree.end()) != (rub == ref.end())) {is_error = true;}
+    if(ub != tree.end() && (*ub)->key() != *rub) {is_error = true;}
+  }
+  unsigned height = 0;
+  if constexpr(requires {tree.height();}) {height = tree.height();}
+  while(!tree.empty()) {tree.erase(tree.begin());}
+  if(tree.begin() != tree.end()) {is_error = true;}
+  if(is_error == false) {
+    std::cout << "Passed " << name << " index test";
+    if(height > 0) {std::cout << " (height=" << height << ")";}
+    std::cout << "." << std::endl;
+  } else {
+    std::cout << "Failed " << name << " index test." << std::endl;
+  }
+}
+
+template<template<class, class, class> class Index>
+void test_try_emplace_range(const std::string& name) {
+  Map<int, double, std::less<int>, Index> seq;
+  Map<int, double, std::less<int>, Index> bat;
+  std::mt19937 gen(11);
+  bool is_error = false;
+  for(int round = 0; round < 12; round++) {
+    int size = (round % 3 == 0) ? 5 : 2000;
+    std::uniform_int_distribution<int> key(0, 3*size);
+    std::vector<std::pair<int,double>> items;
+    for(int i = 0; i < size; i++) {items.emplace_back(key(gen), i);}
+    if(round % 2 == 0) {seq.clear(); bat.clear();}
+    std::size_t count = 0;
+    for(auto& item : items) {
+      if(seq.try_emplace(item.first, item.second).IsValid()) {count++;}
+    }
+    if(bat.try_emplace_range(items) != count) {is_error = true;}
+    std::map<int,double> a, b;
+    for(auto it = seq.list_begin(); it != seq.list_end(); it++) {
+      if(it->clr() == seq.getClr()) {a[it->key()] = it->val();}
+    }
+    for(auto it = bat.list_begin(); it != bat.list_end(); it++) {
+      if(it->clr() == bat.getClr()) {b[it->key()] = it->val();}
+    }
+    if(a != b) {is_error = true;}
+    int previous = -1;
+    for(auto itm = bat.map_begin(); itm != bat.map_end(); itm++) {
+      if(itm->key() <= previous) {is_error = true;}
+      previous = itm->key();
+    }
+  }
+  if(is_error == false) {
+    std::cout << "Passed " << name << " try_emplace_range test." << std::endl;
+  } else {
+    std::cout << "Failed " << name << " try_emplace_range test." << std::endl;
+  }
+}
+
+template<template<class, class, class> class Index>
+void test_upsert(const std::string& name) {
+  Map<int, double, std::less<int>, Index> map;
+  std::map<int,double> ref;
+  std::mt19937 gen(5);
+  std::uniform_int_distribution<int> key(0, 3000);
+  auto plus = [](double& a, const double& b) {a += b;};
+  bool is_error = false;
+  for(int round = 0; round < 6; round++) {
+    map.clear(); ref.clear();
+    for(int i = 0; i < 5000*(round + 1); i++) {
+      int k = key(gen);
+      bool emplaced = map.upsert(k, 1.0, plus).IsValid();
+      if(emplaced != (ref.count(k) == 0)) {is_error = true;}
+      ref[k] += 1.0;
+    }
+    std::map<int,double> a;
+    for(auto it = map.list_begin(); it != map.list_end(); it++) {
+      if(it->clr() == map.getClr()) {a[it->key()] = it->val();}
+    }
+    if(a != ref) {is_error = true;}
+  }
+  if(is_error == false) {
+    std::cout << "Passed " << name << " upsert test." << std::endl;
+  } else {
+    std::cout << "Failed " << name << " upsert test." << std::endl;
+  }
+}
+
+template<template<class, class, class> class Index>
+void test_shrink(const std::string& name) {
+  Map<int, double, std::less<int>, Index> map;
+  bool is_error = false;
+  for(int i = 0; i < 100000; i++) {map.try_emplace(i, i);}
+  map.clear();
+  for(int i = 0; i < 1000; i++) {map.try_emplace(3*i + 1, i);}
+  if(map.shrink_to(0) != 99000 || map.capacity() != 1000) {is_error = true;}
+  map.clear();
+  for(int i = 0; i < 500; i++) {map.try_emplace(3*i + 1, -i);}
+  if(map.shrink_to(700) != 300 || map.capacity() != 700) {is_error = true;}
+  if(map.countLive() != 500) {is_error = true;}
+  int k = 0;
+  for(auto itm = map.map_begin(); itm != map.map_end(); itm++, k++) {
+    if(itm->clr() != map.getClr()) {continue;}
+    if(itm->key() != 3*(itm->key()/3) + 1 || itm->val() != -(itm->key()/3)) {
+      is_error = true;
+    }
+  }
+  if(k != 700) {is_error = true;}
+  /* automatic rule: a small generation trims the leftovers of a big one */
+  map.setTrimFactor(2);
+  map.clear();
+  for(int i = 0; i < 100000; i++) {map.try_emplace(i, i);}
+  map.clear();
+  if(map.capacity() != 100000) {is_error = true;}
+  for(int i = 0; i < 10; i++) {map.try_emplace(i, i);}
+  map.clear();
+  if(map.capacity() != 20) {is_error = true;}
+  for(int i = 0; i < 10; i++) {
+    if(map.try_emplace(i, i).IsValid() == false) {is_error = true;}
+  }
+  if(map.map_find(9) == map.map_end() || map.countLive() != 10) {
+    is_error = true;
+  }
+  if(is_error == false) {
+    std::cout << "Passed " << name << " shrink test." << std::endl;
+  } else {
+    std::cout << "Failed " << name << " shrink test." << std::endl;
+  }
+}
+
+template<template<class, class, class> class Index>
+void test_erase(const std::string& name) {
+  Map<int, double, std::less<int>, Index> map;
+  std::map<int,double> ref;
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<int> key(0, 2000);
+  bool is_error = false;
+  for(int round = 0; round < 8; round++) {
+    for(int i = 0; i < 3000; i++) {
+      int k = key(gen);
+      if(i % 3 == 0) {
+        auto itm = map.map_find(k);
+        if(itm != map.map_end()) {map.erase(itm);}
+        ref.erase(k);
+      } else if(map.try_emplace(k, k + round).IsValid()) {
+        ref[k] = k + round;
+      }
+    }
+    /* erased nodes are reused before any new node is made */
+    std::size_t capacity = map.capacity();
+    std::size_t pruned = map.erase_if(
+      [](const int& k, const double&) {return k % 2 == 0;});
+    for(auto it = ref.begin(); it != ref.end();) {
+      if(it->first % 2 == 0) {it = ref.erase(it); pruned--;} else {it++;}
+    }
+    if(pruned != 0 || map.capacity() != capacity) {is_error = true;}
+    std::map<int,double> a;
+    for(auto it = map.list_begin(); it != map.list_end(); it++) {
+      if(it->clr() == map.getClr()) {a[it->key()] = it->val();}
+    }
+    std::size_t indexed = 0;
+    for(auto itm = map.map_begin(); itm != map.map_end(); itm++) {indexed++;}
+    if(a != ref || indexed > capacity) {is_error = true;}
+    for(int k = 0; k < 100; k++) {map.try_emplace(2*k, 0); ref.emplace(2*k, 0);}
+    if(map.capacity() != capacity) {is_error = true;}
+    if(round % 3 == 1) {map.clear(); ref.clear();}
+    if(round % 3 == 2) {map.shrink_to(round*100);}
+  }
+  if(is_error == false) {
+    std::cout << "Passed " << name << " erase test." << std::endl;
+  } else {
+    std::cout << "Failed " << name << " erase test." << std::endl;
+  }
+}
+
+template<template<class, class, class> class Index>
+void test_merge(const std::string& name) {
+  typedef Map<int, double, std::less<int>, Index> MapT;
+  std::mt19937 gen(11);
+  auto plus = [](double& a, const double& b) {a += b;};
+  bool is_error = false;
+  /* dense and sparse right sides, over stale and erased entries */
+  for(int sizeB : {4000, 20}) {
+    MapT a; MapT b;
+    std::map<int,double> ref;
+    std::uniform_int_distribution<int> key(0, 5000);
+    for(int i = 0; i < 3000; i++) {a.try_emplace(key(gen), 1);}
+    a.clear();
+    for(int i = 0; i < 3000; i++) {
+      int k = key(gen);
+      if(a.try_emplace(k, k).IsValid()) {ref[k] = k;}
+    }
+    a.erase_if([](const int& k, const double&) {return k % 7 == 0;});
+    for(auto it = ref.begin(); it != ref.end();) {
+      if(it->first % 7 == 0) {it = ref.erase(it);} else {it++;}
+    }
+    for(int i = 0; i < sizeB; i++) {b.try_emplace(key(gen), -1);}
+    b.clear();
+    std::map<int,double> refB;
+    for(int i = 0; i < sizeB; i++) {
+      int k = key(gen);
+      if(b.try_emplace(k, 0.5).IsValid()) {refB[k] = 0.5;}
+    }
+    std::size_t emplaced = 0;
+    for(auto& e : refB) {
+      if(ref.count(e.first) == 0) {emplaced++;}
+      ref[e.first] += e.second;
+    }
+    if(a.merge(b, plus) != emplaced) {is_error = true;}
+    std::map<int,double> got;
+    for(auto it = a.list_begin(); it != a.list_end(); it++) {
+      if(it->clr() == a.getClr()) {got[it->key()] = it->val();}
+    }
+    std::size_t indexed = 0;
+    for(auto itm = a.map_begin(); itm != a.map_end(); itm++) {
+      if(a.map_find(itm->key()) != itm) {is_error = true;}
+      indexed++;
+    }
+    if(got != ref || indexed > a.capacity()) {is_error = true;}
+    a.merge(a, plus);
+    for(auto it = a.list_begin(); it != a.list_end(); it++) {
+      if(it->clr() == a.getClr() && it->val() != 2*ref[it->key()]) {
+        is_error = true;
+      }
+    }
+  }
+  if(is_error == false) {
+    std::cout << "Passed " << name << " merge test." << std::endl;
+  } else {
+    std::cout << "Failed " << name << " merge test." << std::endl;
+  }
+}
+
+template<template<class, class, class> class Index>
+void test_sort_list(const std::string& name) {
+  Map<int, double, std::less<int>, Index> map;
+  std::set<int> ref;
+  std::mt19937 gen(13);
+  std::uniform_int_distribution<int> key(0, 4000);
+  bool is_error = false;
+  for(int round = 0; round < 40; round++) {
+    /* few changes on most rounds, many on some */
+    int changes = (round % 5 == 0) ? 3000 : 40;
+    for(int i = 0; i < changes; i++) {
+      int k = key(gen);
+      if(i % 4 == 0) {
+        auto itm = map.map_find(k);
+        if(itm != map.map_end()) {map.erase(itm);}
+        ref.erase(k);
+      } else {
+        map.try_emplace(k, k);
+        ref.insert(k);
+      }
+    }
+    if(round % 7 == 3) {map.clear(); ref.clear(); map.shrink_to(round*50);}
+    if(round % 7 == 5) {map.setClr(map.getClr());}
+    map.sort_list();
+    std::vector<int> a;
+    for(auto it = map.list_begin(); it != map.list_end(); it++) {
+      if(it->clr() != map.getClr()) {break;}
+      a.push_back(it->key());
+    }
+    if(a != std::vector<int>(ref.begin(), ref.end())) {is_error = true;}
+    /* sorting again leaves the list alone */
+    auto first = map.list_begin();
+    map.sort_list();
+    if(map.list_begin() != first) {is_error = true;}
+  }
+  if(is_error == false) {
+    std::cout << "Passed " << name << " sort_list test." << std::endl;
+  } else {
+    std::cout << "Failed " << name << " sort_list test." << std::endl;
+  }
+}
+
+template<template<class, class, class> class Index>
+void test_hint(const std::string& name) {
+  Map<int, double, std::less<int>, Index> map;
+  std::map<int,double> ref;
+  std::mt19937 gen(17);
+  std::uniform_int_distribution<int> key(0, 6000);
+  bool is_error = false;
+  for(int round = 0; round < 6; round++) {
+    if(round % 2 == 1) {map.clear(); ref.clear();}
+    /* a sorted stream with gaps and repeats, then scattered keys */
+    auto hint = map.map_end();
+    for(int k = round; k < 6000; k += 1 + (k % 5)) {
+      bool emplaced = ref.count(k) == 0;
+      hint = map.try_emplace_hint(hint, k, k + 0.5);
+      if(hint.IsValid() != emplaced) {is_error = true;}
+      if(hint == map.map_end() || hint->key() != k) {is_error = true;}
+      ref.emplace(k, k + 0.5);
+    }
+    for(int i = 0; i < 1000; i++) {
+      int k = key(gen);
+      bool emplaced = ref.count(k) == 0;
+      hint = map.try_emplace_hint(hint, k, -k);
+      if(hint.IsValid() != emplaced || hint->key() != k) {is_error = true;}
+      ref.emplace(k, -k);
+    }
+    hint = map.map_begin();
+    for(int k = 0; k < 6000; k++) {
+      hint = map.map_find_hint(k, hint);
+      bool found = hint != map.map_end() && hint->clr() == map.getClr();
+      if(found != (ref.count(k) == 1)) {is_error = true;}
+      if(found && hint->val() != ref[k]) {is_error = true;}
+      if(hint == map.map_end()) {hint = map.map_begin();}
+    }
+  }
+  if(is_error == false) {
+    std::cout << "Passed " << name << " hint test." << std::endl;
+  } else {
+    std::cout << "Failed " << name << " hint test." << std::endl;
+  }
+}
+
+struct LessMod10 {
+  bool operator() (const int& a, const int& b) const {return a % 10 < b % 10;}
+};
+
+template<template<class, class, class> class Index>
+void test_orders(const std::string& name) {
+  typedef Map<int, double, std::less<int>, Index, std::greater<int>, LessMod10>
+    MapT;
+  MapT map;
+  std::map<int,double> ref;
+  std::mt19937 gen(19);
+  std::uniform_int_distribution<int> key(0, 3000);
+  bool is_error = false;
+  for(int round = 0; round < 12; round++) {
+    for(int i = 0; i < 2000; i++) {
+      int k = key(gen);
+      if(i % 5 == 0) {
+        auto itm = map.map_find(k);
+        if(itm != map.map_end()) {map.erase(itm);}
+        ref.erase(k);
+      } else if(map.try_emplace(k, k).IsValid()) {
+        ref[k] = k;
+      }
+    }
+    std::vector<std::pair<int,double>> items;
+    for(int i = 0; i < 500; i++) {items.emplace_back(key(gen), -1);}
+    map.try_emplace_range(items);
+    for(auto& item : items) {ref.emplace(item.first, item.second);}
+    /* re-keys move entries in every order */
+    auto itm = map.map_find(7);
+    if(itm != map.map_end() && itm->clr() == map.getClr()
+      && ref.count(3007) == 0 && map.map_find(3007) == map.map_end()) {
+      map.reInsertKey(itm, 3007);
+      ref[3007] = ref[7]; ref.erase(7);
+    }
+    map.erase_if([](const int& k, const double&) {return k % 13 == 0;});
+    for(auto it = ref.begin(); it != ref.end();) {
+      if(it->first % 13 == 0) {it = ref.erase(it);} else {it++;}
+    }
+    std::vector<int> byIndex;
+    for(auto it = map.map_begin(); it != map.map_end(); it++) {
+      byIndex.push_back(it->key());
+    }
+    std::vector<int> desc;
+    std::size_t size0 = 0;
+    for(auto it = map.template order_begin<0>();
+      it != map.template order_end<0>(); it++, size0++) {
+      if(it->clr() == map.getClr()) {desc.push_back(it->key());}
+    }
+    std::vector<int> mod;
+    std::size_t size1 = 0;
+    for(auto it = map.template order_begin<1>();
+      it != map.template order_end<1>(); it++, size1++) {
+      if(it->clr() == map.getClr()) {mod.push_back(it->key());}
+    }
+    std::vector<int> expect;
+    for(auto& e : ref) {expect.push_back(e.first);}
+    std::vector<int> expectDesc(expect.rbegin(), expect.rend());
+    std::vector<int> expectMod = expect;
+    std::stable_sort(expectMod.begin(), expectMod.end(), LessMod10());
+    if(desc != expectDesc || mod != expectMod) {is_error = true;}
+    if(size0 != byIndex.size() || size1 != byIndex.size()) {is_error = true;}
+    auto lb = map.template order_lower_bound<1>(25);
+    if(ref.size() > 0 && lb != map.template order_end<1>()
+      && (lb->key() % 10 < 5 || (lb->key() % 10 == 5 && lb->key() < 25))) {
+      is_error = true;
+    }
+    if(round % 4 == 1) {map.clear(); ref.clear();}
+    if(round % 4 == 2) {map.shrink_to(round*200);}
+    if(round % 4 == 3) {
+      MapT other;
+      for(int i = 0; i < 800; i++) {other.try_emplace(key(gen), 2);}
+      map.merge(other, [](double& a, const double& b) {a += b;});
+      for(auto it = other.list_begin(); it != other.list_end(); it++) {
+        ref[it->key()] += it->val();
+      }
+    }
+  }
+  if(is_error == false) {
+    std::cout << "Passed " << name << " orders test." << std::endl;
+  } else {
+    std::cout << "Failed " << name << " orders test." << std::endl;
+  }
+}
+
+template<template<class, class, class> class Index>
+void test_concurrent_readers(const std::string& name) {
+  Map<int, double, std::less<int>, Index> map;
+  for(int i = 0; i < 20000; i++) {map.try_emplace(2*i, i);}
+  const auto& reader = map;
+  std::vector<int> errors(8, 0);
+  std::vector<std::thread> threads;
+  for(int t = 0; t < 8; t++) {
+    threads.emplace_back([&reader, &errors, t]() {
+      for(int k = t; k < 40000; k += 8) {
+        auto itm = reader.map_cfind(k);
+        if((itm != reader.map_cend()) != (k % 2 == 0)) {errors[t]++;}
+        auto lb = reader.map_clower_bound(k);
+        if(k < 39998 && lb->key() != k + (k % 2)) {errors[t]++;}
+      }
+      int n = 0;
+      for(auto itm = reader.map_cbegin(); itm != reader.map_cend(); itm++) {
+        if(itm->key() != 2*n) {errors[t]++;}
+        n++;
+      }
+      if(n != 20000) {errors[t]++;}
+    });
+  }
+  for(auto& thread : threads) {thread.join();}
+  bool is_error = false;
+  for(auto e : errors) {if(e != 0) {is_error = true;}}
+  if(is_error == false) {
+    std::cout << "Passed " << name << " concurrent readers test." << std::endl;
+  } else {
+    std::cout << "Failed " << name << " concurrent readers test." << std::endl;
+  }
+}
+
+void test_sharded_map() {
+  ShardedMap<int, double> hashed(5);
+  ShardedMap<int, double> ranged(std::vector<int>{1000, 2000, 3000});
+  std::vector<std::vector<std::pair<int,double>>> items(4);
+  std::mt19937 gen(3);
+  std::uniform_int_distribution<int> key(0, 3999);
+  auto plus = [](double& a, const double& b) {a += b;};
+  bool is_error = false;
+  for(int round = 0; round < 2; round++) {
+    std::map<int,double> ref;
+    for(auto& part : items) {
+      part.clear();
+      for(int i = 0; i < 3000; i++) {
+        part.emplace_back(key(gen), 1.0);
+        ref[part.back().first] += 1.0;
+      }
+    }
+    hashed.clear(); ranged.clear();
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; t++) {
+      threads.emplace_back([&, t]() {
+        for(auto& e : items[t]) {hashed.upsert(e.first, e.second, plus);}
+        ranged.upsert_range(items[t], plus);
+      });
+    }
+    for(auto& thread : threads) {thread.join();}
+    for(auto* m : {&hashed, &ranged}) {
+      auto itr = ref.begin();
+      for(auto it = m->cbegin(); it != m->cend(); it++, itr++) {
+        if(itr == ref.end() || it.key() != itr->first
+          || it.val() != itr->second) {is_error = true; break;}
+      }
+      if(itr != ref.end() || m->countLive() != ref.size()) {is_error = true;}
+    }
+    double v = 0;
+    if(!ranged.find(ref.begin()->first, v) || v != ref.begin()->second) {
+      is_error = true;
+    }
+    if(ranged.shardOf(1999) != 1 || ranged.shardOf(2000) != 2) {
+      is_error = true;
+    }
+  }
+  if(is_error == false) {
+    std::cout << "Passed sharded map test." << std::endl;
+  } else {
+    std::cout << "Failed sharded map test." << std::endl;
+  }
+}
+
+struct Heavy {
+  static int s_copies;
+  std::vector<double> data_;
+  Heavy() {}
+  Heavy(std::size_t n, double x) : data_(n, x) {}
+  Heavy(const Heavy& h) : data_(h.data_) {s_copies++;}
+  Heavy(Heavy&&) = default;
+  Heavy& operator=(const Heavy& h) {data_ = h.data_; s_copies++; return *this;}
+  Heavy& operator=(Heavy&&) = default;
+};
+int Heavy::s_copies = 0;
+
+template<template<class, class, class> class Index>
+void test_emplace(const std::string& name) {
+  Map<int, Heavy, std::less<int>, Index> map;
+  bool is_error = false;
+  for(int i = 0; i < 1000; i++) {map.emplace(i, 64, double(i));}
+  for(int i = 0; i < 1000; i++) {map.try_emplace(i + 1000, Heavy(64, i));}
+  if(map.emplace(5, 1, 0.0).IsValid()) {is_error = true;}
+  map.clear();
+  /* revives stale entries and reuses stale nodes */
+  for(int i = 0; i < 3000; i += 2) {map.emplace(i, 8, double(-i));}
+  for(int i = 0; i < 3000; i += 2) {
+    map.upsert(i, Heavy(8, 1.0), [](Heavy& a, const Heavy& b) {
+      for(std::size_t j = 0; j < a.data_.size(); j++) {a.data_[j] += b.data_[j];}
+    });
+  }
+  if(Heavy::s_copies != 0) {is_error = true;}
+  auto itm = map.map_find(2000);
+  if(itm == map.map_end() || itm->val().data_.size() != 8
+    || itm->val().data_[0] != -1999.0) {is_error = true;}
+  if(is_error == false) {
+    std::cout << "Passed " << name << " emplace test." << std::endl;
+  } else {
+    std::cout << "Failed " << name << " emplace test." << std::endl;
+  }
+}
+
 int main() {
+  test_slab_pool();
+  test_index<BTreeIndex>("btree");
+  test_index<HashIndex>("hash");
+  test_try_emplace_range<SetIndex>("set");
+  test_try_emplace_range<BTreeIndex>("btree");
+  test_try_emplace_range<HashIndex>("hash");
+  test_upsert<SetIndex>("set");
+  test_upsert<BTreeIndex>("btree");
+  test_upsert<HashIndex>("hash");
+  test_shrink<SetIndex>("set");
+  test_shrink<BTreeIndex>("btree");
+  test_shrink<HashIndex>("hash");
+  test_erase<SetIndex>("set");
+  test_erase<BTreeIndex>("btree");
+  test_erase<HashIndex>("hash");
+  test_merge<SetIndex>("set");
+  test_merge<BTreeIndex>("btree");
+  test_merge<HashIndex>("hash");
+  test_sort_list<SetIndex>("set");
+  test_sort_list<BTreeIndex>("btree");
+  test_sort_list<HashIndex>("hash");
+  test_hint<SetIndex>("set");
+  test_hint<BTreeIndex>("btree");
+  test_hint<HashIndex>("hash");
+  test_orders<SetIndex>("set");
+  test_orders<BTreeIndex>("btree");
+  test_orders<HashIndex>("hash");
+  test_concurrent_readers<SetIndex>("set");
+  test_concurrent_readers<BTreeIndex>("btree");
+  test_concurrent_readers<HashIndex>("hash");
+  test_sharded_map();
+  test_emplace<SetIndex>("set");
+  test_emplace<BTreeIndex>("btree");
+  test_emplace<HashIndex>("hash");
   struct K {
     int x; int y;
     K() {};
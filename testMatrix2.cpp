@@ -27,7 +27,9 @@ The rationale for the trailing underscore and the global/static prefixes is that
 #include <cmath>
 #include <string>
 #include <random>
-#include "Matrix.hpp"
+#include <thread>
+#include "Matrix2.hpp"
+#include "MonomialMatrix.hpp"
 #include <sstream>
 
 
@@ -89,6 +91,22 @@ void test_transpose() {
   std::cout << "mat.map_.getClr()=" << mat.map_.getClr() << std::endl;
 }
 
+void test_transpose_empty() {
+  /* transposing an empty matrix moves to a new generation; the sentinel
+  of the list then looks stale but must not be reused by the next add */
+  Matrix mat;
+  mat.transpose_emplace();
+  mat.add(1,2,3);
+  mat.add(2,1,4);
+  bool is_error = mat.getCoeff(1,2) != V(3) || mat.getCoeff(2,1) != V(4)
+    || mat.map_.countLive() != 2;
+  if(is_error == false) {
+    std::cout << "Passed empty transpose test." << std::endl;
+  } else {
+    std::cout << "Failed empty transpose test." << std::endl;
+  }
+}
+
 void test_pesABt() {
   Matrix A;
   std::vector<T> tA = {
@@ -170,9 +188,605 @@ void test_pesABt() {
 
 }
 
+void test_pesABt_random() {
+  const I n = 37;
+  std::default_random_engine rand_gen(7);
+  std::uniform_real_distribution<double> urd(-1, 1);
+  std::uniform_int_distribution<I> uid(0, n-1);
+  std::vector<V> a(n*n, 0), b(n*n, 0), c(n*n, 0);
+  Matrix A; Matrix B; Matrix C;
+  for(uint32_t i = 0; i < 4*n; i++) {
+    I x = uid(rand_gen); I y = uid(rand_gen); V v(urd(rand_gen),urd(rand_gen));
+    A.add(x,y,v); a[x*n+y] += v;
+    x = uid(rand_gen); y = uid(rand_gen); v = V(urd(rand_gen),urd(rand_gen));
+    B.add(x,y,v); b[x*n+y] += v;
+  }
+  V s(0.5,-2);
+  for(I x = 0; x < n; x++) {
+    for(I y = 0; y < n; y++) {
+      for(I k = 0; k < n; k++) {
+        c[x*n+y] += s*a[x*n+k]*b[y*n+k];
+      }
+    }
+  }
+  C.pesABt(s,A,B);
+  bool is_error = false;
+  for(I x = 0; x < n; x++) {
+    for(I y = 0; y < n; y++) {
+      if(std::abs(C.getCoeff(x,y)-c[x*n+y])>1.e-10) {is_error = true;}
+    }
+  }
+  /* only structural nonzeros of A*B^t are written */
+  uint32_t nnz = 0;
+  for(auto itm = C.map_.map_begin(); itm != C.map_.map_end(); itm++) {
+    nnz++;
+    if(c[itm->key().x_*n+itm->key().y_] == V(0)) {is_error = true;}
+  }
+  if(is_error == false) {
+    std::cout << "Passed pesABt random test (nnz=" << nnz << ")." << std::endl;
+  } else {
+    std::cout << "Failed pesABt random test." << std::endl;
+  }
+}
+
+void test_pesABt_threads() {
+  const I n = 200;
+  std::default_random_engine rand_gen(11);
+  std::uniform_real_distribution<double> urd(-1, 1);
+  std::uniform_int_distribution<I> uid(0, n-1);
+  Matrix A; Matrix B; Matrix C1; Matrix C4;
+  for(uint32_t i = 0; i < 8*n; i++) {
+    A.add(uid(rand_gen),uid(rand_gen),V(urd(rand_gen),urd(rand_gen)));
+    B.add(uid(rand_gen),uid(rand_gen),V(urd(rand_gen),urd(rand_gen)));
+  }
+  C1.pesABt(V(1,1),A,B);
+  C4.setThreads(4);
+  C4.pesABt(V(1,1),A,B);
+  bool is_error = false;
+  auto itm1 = C1.map_.map_begin(); auto itm4 = C4.map_.map_begin();
+  while(itm1 != C1.map_.map_end() && itm4 != C4.map_.map_end()) {
+    if(itm1->key().x_ != itm4->key().x_ || itm1->key().y_ != itm4->key().y_
+      || itm1->val().v_ != itm4->val().v_) {is_error = true;}
+    itm1++; itm4++;
+  }
+  if(itm1 != C1.map_.map_end() || itm4 != C4.map_.map_end()) {is_error = true;}
+  if(is_error == false) {
+    std::cout << "Passed pesABt threads test." << std::endl;
+  } else {
+    std::cout << "Failed pesABt threads test." << std::endl;
+  }
+}
+
+bool same_entries(Matrix& C1, Matrix& C2) {
+  auto itm1 = C1.map_.map_begin(); auto itm2 = C2.map_.map_begin();
+  while(itm1 != C1.map_.map_end() && itm2 != C2.map_.map_end()) {
+    if(itm1->key().x_ != itm2->key().x_ || itm1->key().y_ != itm2->key().y_
+      || itm1->val().v_ != itm2->val().v_) {return false;}
+    itm1++; itm2++;
+  }
+  return itm1 == C1.map_.map_end() && itm2 == C2.map_.map_end();
+}
+
+void test_symbolic_numeric() {
+  const I n = 100;
+  std::default_random_engine rand_gen(13);
+  std::uniform_real_distribution<double> urd(-1, 1);
+  std::uniform_int_distribution<I> uid(0, n-1);
+  Matrix A; Matrix B; Matrix C1; Matrix C2;
+  for(uint32_t i = 0; i < 6*n; i++) {
+    A.add(uid(rand_gen),uid(rand_gen),V(urd(rand_gen),urd(rand_gen)));
+    B.add(uid(rand_gen),uid(rand_gen),V(urd(rand_gen),urd(rand_gen)));
+  }
+  C2.symbolicABt(A,B);
+  bool is_error = false;
+  for(int rep = 0; rep < 3; rep++) {
+    /* only the coefficients of A change between products */
+    for(auto itl = A.map_.list_begin(); itl != A.map_.list_end(); itl++) {
+      itl->val().v_ *= V(0.5,1);
+    }
+    C1.map_.clear();
+    C1.pesABt(V(2,-1),A,B);
+    for(auto itl = C2.map_.list_begin(); itl != C2.map_.list_end(); itl++) {
+      itl->val().v_ = 0;
+    }
+    C2.numericABt(V(2,-1));
+    if(!same_entries(C1,C2)) {is_error = true;}
+  }
+  C2.numericABt(V(2,-1));
+  C1.pesABt(V(2,-1),A,B);
+  if(!same_entries(C1,C2)) {is_error = true;}
+  if(is_error == false) {
+    std::cout << "Passed symbolic/numeric test." << std::endl;
+  } else {
+    std::cout << "Failed symbolic/numeric test." << std::endl;
+  }
+}
+
+void test_sharded_add() {
+  const I n = 300;
+  const unsigned threads = 8;
+  std::vector<std::vector<std::pair<Matrix::K,V>>> items(threads);
+  std::default_random_engine rand_gen(17);
+  std::uniform_int_distribution<I> uid(0, n-1);
+  std::uniform_int_distribution<int> val(-4, 4);
+  Matrix C1; Matrix C2;
+  for(auto& part : items) {
+    for(int i = 0; i < 4000; i++) {
+      part.emplace_back(Matrix::K(uid(rand_gen),uid(rand_gen)),
+        V(val(rand_gen),val(rand_gen)));
+      C1.add(part.back().first.x_, part.back().first.y_, part.back().second);
+    }
+  }
+  Matrix::ShardedMapT acc(threads);
+  std::vector<std::thread> workers;
+  for(unsigned t = 0; t < threads; t++) {
+    workers.emplace_back([&acc, &items, t]() {
+      for(auto& e : items[t]) {
+        Matrix::add(acc, e.first.x_, e.first.y_, e.second);
+      }
+    });
+  }
+  for(auto& w : workers) {w.join();}
+  C2.gather(acc);
+  bool is_error = !same_entries(C1,C2);
+  Matrix::K previous(0,0);
+  std::size_t count = 0;
+  for(auto it = acc.cbegin(); it != acc.cend(); it++, count++) {
+    if(count > 0 && !(previous < it.key())) {is_error = true;}
+    if(it.val().v_ != C1.getCoeff(it.key().x_, it.key().y_)) {is_error = true;}
+    previous = it.key();
+  }
+  if(count != acc.countLive()) {is_error = true;}
+  if(is_error == false) {
+    std::cout << "Passed sharded add test." << std::endl;
+  } else {
+    std::cout << "Failed sharded add test." << std::endl;
+  }
+}
+
+void test_prune() {
+  const I n = 29;
+  std::default_random_engine rand_gen(23);
+  std::uniform_real_distribution<double> urd(-1, 1);
+  std::uniform_int_distribution<I> uid(0, n-1);
+  Matrix A; Matrix B; Matrix C;
+  for(uint32_t i = 0; i < 6*n; i++) {
+    A.add(uid(rand_gen), uid(rand_gen), V(urd(rand_gen),urd(rand_gen)));
+    B.add(uid(rand_gen), uid(rand_gen), V(urd(rand_gen),urd(rand_gen)));
+  }
+  C.pesABt(1,A,B);
+  std::vector<V> c(n*n, 0);
+  std::size_t small = 0;
+  for(I x = 0; x < n; x++) {
+    for(I y = 0; y < n; y++) {
+      c[x*n+y] = C.getCoeff(x,y);
+      if(c[x*n+y] != V(0) && std::abs(c[x*n+y]) <= 0.5) {small++;}
+    }
+  }
+  bool is_error = C.prune(0.5) != small;
+  for(I x = 0; x < n; x++) {
+    for(I y = 0; y < n; y++) {
+      V expect = std::abs(c[x*n+y]) <= 0.5 ? V(0) : c[x*n+y];
+      if(C.getCoeff(x,y) != expect) {is_error = true;}
+    }
+  }
+  /* the product is rebuilt on the freed nodes */
+  std::size_t capacity = C.map_.capacity();
+  C.map_.clear();
+  C.pesABt(1,A,B);
+  for(I x = 0; x < n; x++) {
+    for(I y = 0; y < n; y++) {
+      if(std::abs(C.getCoeff(x,y)-c[x*n+y])>1.e-10) {is_error = true;}
+    }
+  }
+  if(C.map_.capacity() != capacity) {is_error = true;}
+  if(is_error == false) {
+    std::cout << "Passed prune test (pruned=" << small << ")." << std::endl;
+  } else {
+    std::cout << "Failed prune test." << std::endl;
+  }
+}
+
+void test_pesA() {
+  const I n = 31;
+  std::default_random_engine rand_gen(29);
+  std::uniform_real_distribution<double> urd(-1, 1);
+  std::uniform_int_distribution<I> uid(0, n-1);
+  std::vector<V> a(n*n, 0), c(n*n, 0);
+  Matrix A; Matrix C;
+  for(uint32_t i = 0; i < 5*n; i++) {
+    I x = uid(rand_gen); I y = uid(rand_gen); V v(urd(rand_gen),urd(rand_gen));
+    A.add(x,y,v); a[x*n+y] += v;
+    x = uid(rand_gen); y = uid(rand_gen); v = V(urd(rand_gen),urd(rand_gen));
+    C.add(x,y,v); c[x*n+y] += v;
+  }
+  V s(0.5,-2);
+  C.pesA(s,A);
+  C.pesA(1,A);
+  bool is_error = false;
+  for(I x = 0; x < n; x++) {
+    for(I y = 0; y < n; y++) {
+      if(std::abs(C.getCoeff(x,y)-c[x*n+y]-(s+V(1))*a[x*n+y])>1.e-10) {
+        is_error = true;
+      }
+    }
+  }
+  if(is_error == false) {
+    std::cout << "Passed pesA test." << std::endl;
+  } else {
+    std::cout << "Failed pesA test." << std::endl;
+  }
+}
+
+void test_col_order() {
+  const I n = 40;
+  std::default_random_engine rand_gen(31);
+  std::uniform_int_distribution<I> uid(0, n-1);
+  Matrix::ColMapT map;
+  Matrix A;
+  for(int i = 0; i < 600; i++) {
+    I x = uid(rand_gen); I y = uid(rand_gen);
+    map.upsert(Matrix::K(x,y), Matrix::V(V(x,y)),
+      [](Matrix::V& a, const Matrix::V& b) {a.v_ += b.v_;});
+    A.add(y, x, V(x,y));
+  }
+  /* columns of map in order are the rows of its transpose */
+  A.map_.sort_list();
+  bool is_error = false;
+  auto itl = A.map_.list_begin();
+  for(auto it = map.order_begin<0>(); it != map.order_end<0>(); it++) {
+    if(itl == A.map_.list_end() || itl->key().x_ != it->key().y_
+      || itl->key().y_ != it->key().x_ || itl->val().v_ != it->val().v_) {
+      is_error = true;
+      break;
+    }
+    itl++;
+  }
+  if(itl != A.map_.list_end() && itl->clr() == A.map_.getClr()) {
+    is_error = true;
+  }
+  /* A*B^t with B^t read from the column order, the stale entries of an
+  older generation left out, against the same B as a Matrix */
+  Matrix::ColMapT colB;
+  Matrix B;
+  for(int i = 0; i < 600; i++) {
+    colB.try_emplace(Matrix::K(uid(rand_gen), uid(rand_gen)), Matrix::V(1));
+  }
+  colB.clear();
+  for(int i = 0; i < 300; i++) {
+    I x = uid(rand_gen); I y = uid(rand_gen); V v(x, -double(y));
+    colB.upsert(Matrix::K(x,y), Matrix::V(v),
+      [](Matrix::V& a, const Matrix::V& b) {a.v_ += b.v_;});
+    B.add(x, y, v);
+  }
+  Matrix C1; Matrix C2;
+  C1.pesABt(V(0.5,1), A, B);
+  C2.pesABt(V(0.5,1), A, colB);
+  for(I x = 0; x < n; x++) {
+    for(I y = 0; y < n; y++) {
+      if(std::abs(C1.getCoeff(x,y) - C2.getCoeff(x,y)) > 1.e-12) {
+        is_error = true;
+      }
+    }
+  }
+  if(is_error == false) {
+    std::cout << "Passed column order test." << std::endl;
+  } else {
+    std::cout << "Failed column order test." << std::endl;
+  }
+}
+
+void test_views() {
+  const I n = 23;
+  std::default_random_engine rand_gen(37);
+  std::uniform_real_distribution<double> urd(-1, 1);
+  std::uniform_int_distribution<I> uid(0, n-1);
+  std::vector<V> a(n*n, 0), b(n*n, 0);
+  Matrix A; Matrix B;
+  for(uint32_t i = 0; i < 4*n; i++) {
+    I x = uid(rand_gen); I y = uid(rand_gen); V v(urd(rand_gen),urd(rand_gen));
+    A.add(x,y,v); a[x*n+y] += v;
+    x = uid(rand_gen); y = uid(rand_gen); v = V(urd(rand_gen),urd(rand_gen));
+    B.add(x,y,v); b[x*n+y] += v;
+  }
+  V s(0.5,-2);
+  /* op(M)(x,y) read from the dense copy */
+  auto op = [&](const std::vector<V>& m, bool t, bool c, I x, I y) {
+    V v = t ? m[y*n+x] : m[x*n+y];
+    return c ? std::conj(v) : v;
+  };
+  bool is_error = false;
+  for(int mode = 0; mode < 4; mode++) {
+    bool tA = mode & 1; bool cA = mode & 1;
+    bool tB = mode & 2; bool cB = false;
+    Matrix::View vA = tA ? A.adjoint() : Matrix::View(A);
+    Matrix::View vB = tB ? B.transpose() : Matrix::View(B);
+    Matrix C1; Matrix C2;
+    C1.pesABt(s, vA, vB);
+    C2.symbolicABt(vA, vB);
+    C2.numericABt(s);
+    for(I x = 0; x < n; x++) {
+      for(I y = 0; y < n; y++) {
+        V c = 0;
+        for(I k = 0; k < n; k++) {
+          c += s*op(a, tA, cA, x, k)*op(b, tB, cB, y, k);
+        }
+        if(std::abs(C1.getCoeff(x,y)-c)>1.e-10) {is_error = true;}
+        if(std::abs(C2.getCoeff(x,y)-c)>1.e-10) {is_error = true;}
+      }
+    }
+  }
+  if(is_error == false) {
+    std::cout << "Passed transpose/adjoint view test." << std::endl;
+  } else {
+    std::cout << "Failed transpose/adjoint view test." << std::endl;
+  }
+}
+
+void test_csr() {
+  const I n = 41;
+  std::default_random_engine rand_gen(53);
+  std::uniform_real_distribution<double> urd(-1, 1);
+  std::uniform_int_distribution<I> uid(0, n-1);
+  std::vector<V> a(n*n, 0);
+  Matrix A;
+  /* stale entries of an older generation must not show */
+  for(uint32_t i = 0; i < 3*n; i++) {A.add(uid(rand_gen), uid(rand_gen), 1);}
+  A.map_.clear();
+  for(uint32_t i = 0; i < 6*n; i++) {
+    I x = uid(rand_gen); I y = uid(rand_gen); V v(urd(rand_gen),urd(rand_gen));
+    A.add(x,y,v); a[x*n+y] += v;
+  }
+  bool is_error = false;
+  auto csr = A.toCSR();
+  auto csc = A.toCSC();
+  if(csr.nnz() != A.map_.countLive() || csc.nnz() != csr.nnz()) {
+    is_error = true;
+  }
+  std::vector<V> b(n*n, 0); std::vector<V> c(n*n, 0);
+  for(I x = 0; x < csr.rows(); x++) {
+    for(std::size_t i = csr.ptr()[x]; i < csr.ptr()[x+1]; i++) {
+      if(i > csr.ptr()[x] && csr.idx()[i-1] >= csr.idx()[i]) {is_error = true;}
+      b[x*n+csr.idx()[i]] = csr.val()[i];
+    }
+  }
+  csc.forEach([&](const I& y, const I& x, const V& v) {c[x*n+y] = v;});
+  if(b != a || c != a) {is_error = true;}
+  Matrix B;
+  B.add(0, 0, 5);
+  B.fromCSR(csr);
+  for(I x = 0; x < n; x++) {
+    for(I y = 0; y < n; y++) {
+      if(B.getCoeff(x,y) != a[x*n+y]) {is_error = true;}
+    }
+  }
+  auto again = B.toCSR();
+  if(again.ptr() != csr.ptr() || again.idx() != csr.idx()
+    || again.val() != csr.val()) {
+    is_error = true;
+  }
+  /* repeated (row, col) entries are summed, out-of-order columns sorted */
+  Matrix::CompressedT rep;
+  rep.append(0, 3, 1); rep.append(0, 1, 2); rep.append(0, 3, V(0,4));
+  rep.append(2, 0, 5);
+  B.fromCSR(rep);
+  auto sum = B.toCSR();
+  if(B.getCoeff(0,3) != V(1,4) || B.getCoeff(0,1) != V(2)
+    || B.getCoeff(2,0) != V(5) || sum.nnz() != 3 || sum.idx()[0] != 1
+    || sum.idx()[1] != 3) {
+    is_error = true;
+  }
+  /* writes to map_ that bypass Matrix drop the cached CSR all the same */
+  B.map_.clear();
+  B.map_.try_emplace(Matrix::K(1,2), Matrix::V(3));
+  if(B.csr().nnz() != 1 || B.csr().val()[0] != V(3)) {is_error = true;}
+  for(auto itl = B.map_.list_begin(); itl != B.map_.list_end()
+    && itl->clr() == B.map_.getClr(); itl++) {
+    itl->val().v_ = 4;
+  }
+  if(B.csr().val()[0] != V(4)) {is_error = true;}
+  if(is_error == false) {
+    std::cout << "Passed CSR/CSC test (nnz=" << csr.nnz() << ")." << std::endl;
+  } else {
+    std::cout << "Failed CSR/CSC test." << std::endl;
+  }
+}
+
+void test_apply() {
+  const I n = 97;
+  std::default_random_engine rand_gen(71);
+  std::uniform_real_distribution<double> urd(-1, 1);
+  std::uniform_int_distribution<I> uid(0, n-1);
+  std::vector<V> a(n*n, 0);
+  std::vector<V> x(n); std::vector<V> y(n); std::vector<V> z(n);
+  for(auto& v : x) {v = V(urd(rand_gen),urd(rand_gen));}
+  Matrix A;
+  A.setThreads(3);
+  bool is_error = false;
+  V alpha(0.25,1.5);
+  for(int round = 0; round < 2; round++) {
+    /* the second round checks that add() drops the cached rows */
+    for(uint32_t i = 0; i < 5*n; i++) {
+      I r = uid(rand_gen); I c = uid(rand_gen); V v(urd(rand_gen),urd(rand_gen));
+      A.add(r,c,v); a[r*n+c] += v;
+    }
+    A.add(n-1, 0, 1); a[(n-1)*n] += 1;
+    for(I r = 0; r < n; r++) {y[r] = V(urd(rand_gen),urd(rand_gen));}
+    std::vector<V> y0 = y;
+    z = y;
+    A.apply(x.data(), y.data(), n);
+    A.apply(alpha, x.data(), z.data(), n);
+    for(I r = 0; r < n; r++) {
+      V ax = 0;
+      for(I c = 0; c < n; c++) {ax += a[r*n+c]*x[c];}
+      if(std::abs(y[r]-ax) > 1.e-12) {is_error = true;}
+      if(std::abs(z[r]-(y0[r]+alpha*ax)) > 1.e-12) {is_error = true;}
+    }
+  }
+  /* a y shorter than A takes its first rows only */
+  const I m = n/3;
+  std::vector<V> w(m, V(7,7));
+  A.apply(x.data(), w.data(), m);
+  for(I r = 0; r < m; r++) {
+    V ax = 0;
+    for(I c = 0; c < n; c++) {ax += a[r*n+c]*x[c];}
+    if(std::abs(w[r]-ax) > 1.e-12) {is_error = true;}
+  }
+  /* empty trailing rows of a y that is not zeroed first */
+  Matrix B;
+  B.add(2, 5, V(1,1));
+  std::fill(y.begin(), y.end(), V(7,7));
+  z = y;
+  B.apply(x.data(), y.data(), n);
+  B.apply(alpha, x.data(), z.data(), n);
+  for(I r = 0; r < n; r++) {
+    V bx = r == 2 ? V(1,1)*x[5] : V(0);
+    if(std::abs(y[r]-bx) > 1.e-12) {is_error = true;}
+    if(std::abs(z[r]-(V(7,7)+alpha*bx)) > 1.e-12) {is_error = true;}
+  }
+  if(is_error == false) {
+    std::cout << "Passed apply test." << std::endl;
+  } else {
+    std::cout << "Failed apply test." << std::endl;
+  }
+}
+
+void test_monomial() {
+  /* products, SpMV, adjoint and the round trip through Matrix, against
+  dense arrays, for a permutation with values and a Pauli string */
+  const I q = 6;
+  const I n = I(1) << q;
+  std::default_random_engine rand_gen(73);
+  std::uniform_real_distribution<double> urd(-1, 1);
+  std::vector<I> perm(n);
+  for(I r = 0; r < n; r++) {perm[r] = r;}
+  std::shuffle(perm.begin(), perm.end(), rand_gen);
+  std::vector<V> vals(n);
+  for(auto& v : vals) {v = V(urd(rand_gen),urd(rand_gen));}
+  MonomialMatrix A(perm, vals);
+  MonomialMatrix B;
+  PauliString<> p("XYZIYX");
+  bool is_error = !B.fromPauli(p, q);
+  B.setThreads(3);
+  auto dense = [&](const MonomialMatrix& M) {
+    std::vector<V> d(n*n, 0);
+    for(I r = 0; r < n; r++) {d[r*n+M.col(r)] = M.val(r);}
+    return d;
+  };
+  auto times = [&](const std::vector<V>& a, const std::vector<V>& b) {
+    std::vector<V> c(n*n, 0);
+    for(I r = 0; r < n; r++) {
+      for(I k = 0; k < n; k++) {
+        for(I j = 0; j < n; j++) {c[r*n+j] += a[r*n+k]*b[k*n+j];}
+      }
+    }
+    return c;
+  };
+  auto same = [&](const std::vector<V>& a, const std::vector<V>& b) {
+    for(I i = 0; i < n*n; i++) {if(std::abs(a[i]-b[i]) > 1.e-12) {return false;}}
+    return true;
+  };
+  if(!B.masked() || B.mask() != I(p.x()[0])) {is_error = true;}
+  /* X and Y on qubits 0, 1, 4, 5 flip those bits of the row */
+  if(B.col(0) != I(0b110011)) {is_error = true;}
+  if(!same(dense(A*B), times(dense(A), dense(B)))) {is_error = true;}
+  if(!same(dense(B*A), times(dense(B), dense(A)))) {is_error = true;}
+  if(!(B*B).masked() || !same(dense(B*B), times(dense(B), dense(B)))) {
+    is_error = true;
+  }
+  /* A^t* A is diagonal, |vals[r]|^2 at column perm[r] */
+  auto aa = dense(A.adjoint()*A);
+  std::vector<V> diag(n*n, 0);
+  for(I r = 0; r < n; r++) {diag[perm[r]*n+perm[r]] = std::norm(vals[r]);}
+  if(!same(aa, diag)) {is_error = true;}
+  std::vector<V> x(n); std::vector<V> y(n); std::vector<V> z(n, 1);
+  for(auto& v : x) {v = V(urd(rand_gen),urd(rand_gen));}
+  V alpha(0.5,-2);
+  for(const MonomialMatrix* M : {&A, &B}) {
+    auto d = dense(*M);
+    M->apply(x.data(), y.data());
+    std::fill(z.begin(), z.end(), V(1));
+    M->apply(alpha, x.data(), z.data());
+    for(I r = 0; r < n; r++) {
+      V ax = 0;
+      for(I c = 0; c < n; c++) {ax += d[r*n+c]*x[c];}
+      if(std::abs(y[r]-ax) > 1.e-12) {is_error = true;}
+      if(std::abs(z[r]-(V(1)+alpha*ax)) > 1.e-12) {is_error = true;}
+    }
+    Matrix m;
+    M->toMatrix(m);
+    MonomialMatrix back;
+    if(!back.fromMatrix(m, n)) {is_error = true;}
+    if(back.masked() != M->masked() || !same(dense(back), d)) {is_error = true;}
+  }
+  Matrix two;
+  two.add(3, 1, 1); two.add(3, 2, 1);
+  MonomialMatrix kept = A;
+  if(kept.fromMatrix(two, n) || !same(dense(kept), dense(A))) {is_error = true;}
+  /* entries outside rows x rows are refused, empty rows of a matrix that
+  is not masked keep their columns inside */
+  Matrix outside;
+  outside.add(1, n, 1);
+  if(kept.fromMatrix(outside, n) || !same(dense(kept), dense(A))) {
+    is_error = true;
+  }
+  Matrix below;
+  below.add(n, 1, 1);
+  if(kept.fromMatrix(below, n)) {is_error = true;}
+  Matrix five;
+  five.add(0, 1, 2);
+  if(!kept.fromMatrix(five, 5) || kept.masked() || kept.rows() != 5) {
+    is_error = true;
+  }
+  for(I r = 0; r < kept.rows(); r++) {
+    if(kept.col(r) >= 5) {is_error = true;}
+  }
+  /* strings reaching past the qubits, or past the bits of Index, are
+  refused */
+  MonomialMatrix C = B;
+  PauliString<2> wide;
+  wide.set(70, 'Z');
+  if(C.fromPauli(PauliString<>("IIIIIIX"), q) || C.fromPauli(p, 5)
+    || C.fromPauli(wide, q) || C.fromPauli(PauliString<>("Z"), 32)
+    || !same(dense(C), dense(B))) {
+    is_error = true;
+  }
+  /* a mask taking rows outside leaves them empty */
+  MonomialMatrix D(5, 3);
+  if(D.masked() || D.col(1) != 2 || D.col(4) != 4 || D.val(4) != V(0)
+    || D.val(2) != V(1)) {
+    is_error = true;
+  }
+  MonomialMatrix E(8, 3);
+  if(!E.masked() || E.col(4) != 7) {is_error = true;}
+  /* a product with itself, masked and not */
+  for(MonomialMatrix M : {A, B}) {
+    auto want = times(dense(M), dense(M));
+    M *= M;
+    if(!same(dense(M), want)) {is_error = true;}
+  }
+  if(is_error == false) {
+    std::cout << "Passed monomial test." << std::endl;
+  } else {
+    std::cout << "Failed monomial test." << std::endl;
+  }
+}
+
 int main() {
  // test_transpose();
+  test_transpose_empty();
   test_pesABt();
+  test_pesABt_random();
+  test_pesABt_threads();
+  test_symbolic_numeric();
+  test_sharded_add();
+  test_prune();
+  test_pesA();
+  test_col_order();
+  test_views();
+  test_csr();
+  test_apply();
+  test_monomial();
   return 0;
 }
 /*
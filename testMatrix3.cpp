@@ -27,7 +27,7 @@ The rationale for the trailing underscore and the global/static prefixes is that
 #include <string>
 #include <random>
 #include <sstream>
-#include "Matrix.hpp"
+#include "Matrix3.hpp"
 /*
 */
 
@@ -145,6 +145,64 @@ void test_pesAB() {
   }
 
 }
+void test_pesAB_threads() {
+  const Matrix::Index n = 200;
+  std::default_random_engine rand_gen(11);
+  std::uniform_real_distribution<double> urd(-1, 1);
+  std::uniform_int_distribution<Matrix::Index> uid(0, n-1);
+  Matrix A; Matrix B; Matrix C1; Matrix C4;
+  for(uint32_t i = 0; i < 8*n; i++) {
+    A.add(uid(rand_gen),uid(rand_gen),Matrix::Value(urd(rand_gen),urd(rand_gen)));
+    B.add(uid(rand_gen),uid(rand_gen),Matrix::Value(urd(rand_gen),urd(rand_gen)));
+  }
+  C1.pesAB(1,A,B,false);
+  C4.setThreads(4);
+  C4.pesAB(1,A,B,false);
+  bool is_error = C1.container_.size() != C4.container_.size();
+  auto it1 = C1.xy_begin(); auto it4 = C4.xy_begin();
+  while(!is_error && it1 != C1.container_.get<Matrix::order_xy>().end()) {
+    if(it1->x_ != it4->x_ || it1->y_ != it4->y_ || it1->v_ != it4->v_) {
+      is_error = true;
+    }
+    it1++; it4++;
+  }
+  if(is_error == false) {
+    std::cout << "Passed pesAB threads test." << std::endl;
+  } else {
+    std::cout << "Failed pesAB threads test." << std::endl;
+  }
+}
+
+void test_symbolic_numeric() {
+  const Matrix::Index n = 100;
+  std::default_random_engine rand_gen(13);
+  std::uniform_real_distribution<double> urd(-1, 1);
+  std::uniform_int_distribution<Matrix::Index> uid(0, n-1);
+  Matrix A; Matrix B; Matrix C1; Matrix C2;
+  for(uint32_t i = 0; i < 6*n; i++) {
+    A.add(uid(rand_gen),uid(rand_gen),Matrix::Value(urd(rand_gen),urd(rand_gen)));
+    B.add(uid(rand_gen),uid(rand_gen),Matrix::Value(urd(rand_gen),urd(rand_gen)));
+  }
+  C1.pesAB(1,A,B,true);
+  C2.symbolicAB(A,B);
+  C2.numericAB(1);
+  C1.pesAB(1,A,B,false);
+  C2.numericAB(1);
+  bool is_error = C1.container_.size() != C2.container_.size();
+  auto it1 = C1.xy_begin(); auto it2 = C2.xy_begin();
+  while(!is_error && it1 != C1.container_.get<Matrix::order_xy>().end()) {
+    if(it1->x_ != it2->x_ || it1->y_ != it2->y_ || it1->v_ != it2->v_) {
+      is_error = true;
+    }
+    it1++; it2++;
+  }
+  if(is_error == false) {
+    std::cout << "Passed symbolic/numeric test." << std::endl;
+  } else {
+    std::cout << "Failed symbolic/numeric test." << std::endl;
+  }
+}
+
 void test_stuff() {
   class T {
    public:
@@ -179,6 +237,8 @@ void test_stuff() {
 }
 int main() {
   test_pesAB();
+  test_pesAB_threads();
+  test_symbolic_numeric();
   return 0;
 }
 /*
@@ -0,0 +1,406 @@
+/*
+  Copyright Benjamin Commeau
+
+Use CamelCase for all names. Start types (such as classes, structs, and typedefs) with a capital letter, other names (functions, variables) with a lowercase letter. You may use an all-lowercase name with underscores if your class closely resembles an external construct (e.g., a standard library construct) named that way.
+
+(1) C++ interfaces are named with a Interface suffix, and abstract base classes with an Abstract prefix.
+(2) Member variables are named with a trailing underscore.
+(3) Accessors for a variable foo_ are named foo() and setFoo().
+(4) Global variables are named with a g_ prefix.
+(5) Static class variables are named with a s_ prefix.
+(6) Global constants are often named with a c_ prefix.
+(7) If the main responsibility of a file is to implement a particular class, then the name of the file should match that class, except for possible abbreviations to avoid repetition in file names (e.g., if all classes within a module start with the module name, omitting or abbreviating the module name is OK). Currently, all source file names are lowercase, but this casing difference should be the only difference.
+
+The rationale for the trailing underscore and the global/static prefixes is that it is immediately clear whether a variable referenced in a method is local to the function or has wider scope, improving the readability of the code.
+*/
+
+#include <algorithm>
+#include <iostream>
+#include <complex>
+#include <cmath>
+#include <string>
+#include <random>
+#include <map>
+#include <vector>
+#include "GroupedHamiltonian.hpp"
+#include "Matrix2.hpp"
+#include "PauliSum.hpp"
+
+
+typedef std::complex<double> V;
+
+template<std::size_t W>
+PauliString<W> random_string(std::size_t qubits,
+  std::default_random_engine& rand_gen) {
+  std::uniform_int_distribution<int> uid(0, 3);
+  PauliString<W> p;
+  for(std::size_t q = 0; q < qubits; q++) {p.set(q, "IXYZ"[uid(rand_gen)]);}
+  p.setPhase(uid(rand_gen));
+  return p;
+}
+
+/* P|b> as (coefficient, b^x) on the first word */
+template<std::size_t W>
+std::pair<V,uint64_t> act(const PauliString<W>& p, uint64_t b) {
+  int sign = (std::popcount(p.z()[0] & b) & 1) ? -1 : 1;
+  return {double(sign)*PauliString<W>::power(p.phase()), b ^ p.x()[0]};
+}
+
+void test_string_table() {
+  /* single-qubit products, e.g. XY = iZ */
+  const std::string ops = "IXYZ";
+  const std::string table[4][4] = {
+    {"I", "X", "Y", "Z"},
+    {"X", "I", "iZ", "-iY"},
+    {"Y", "-iZ", "I", "iX"},
+    {"Z", "iY", "-iX", "I"}};
+  bool is_error = false;
+  for(int a = 0; a < 4; a++) {
+    for(int b = 0; b < 4; b++) {
+      PauliString<> p(std::string(1, ops[a]));
+      PauliString<> r(std::string(1, ops[b]));
+      if((p*r).to_string() != table[a][b]) {is_error = true;}
+      bool commutes = (p*r) == (r*p);
+      if(p.commutes(r) != commutes) {is_error = true;}
+    }
+  }
+  if(PauliString<>("IXYZI").to_string() != "IXYZ") {is_error = true;}
+  if(PauliString<>("IXYZI").weight() != 3) {is_error = true;}
+  if(is_error == false) {
+    std::cout << "Passed Pauli table test." << std::endl;
+  } else {
+    std::cout << "Failed Pauli table test." << std::endl;
+  }
+}
+
+void test_string_products() {
+  /* (P1 P2)|b> = P1 (P2|b>) on every basis state of 6 qubits, and strings
+  across the word boundary of PauliString<2> */
+  std::default_random_engine rand_gen(11);
+  bool is_error = false;
+  for(int trial = 0; trial < 200; trial++) {
+    auto p1 = random_string<1>(6, rand_gen);
+    auto p2 = random_string<1>(6, rand_gen);
+    auto p12 = p1*p2;
+    for(uint64_t b = 0; b < 64; b++) {
+      auto s2 = act(p2, b);
+      auto s1 = act(p1, s2.second);
+      auto s12 = act(p12, b);
+      if(s12.second != s1.second || std::abs(s12.first - s1.first*s2.first) > 0) {
+        is_error = true;
+      }
+    }
+    if(p1.commutes(p2) != (p1*p2 == p2*p1)) {is_error = true;}
+    auto w1 = random_string<2>(128, rand_gen);
+    auto w2 = random_string<2>(128, rand_gen);
+    auto w12 = w1*w2;
+    /* qubit by qubit, each factor from the single-qubit table */
+    PauliString<2> check;
+    check.setPhase(w1.phase() + w2.phase());
+    unsigned phase = check.phase();
+    for(std::size_t q = 0; q < 128; q++) {
+      PauliString<1> a(std::string(1, w1.get(q)));
+      PauliString<1> c(std::string(1, w2.get(q)));
+      if(w1.get(q) == 'Y') {phase += 3;}
+      if(w2.get(q) == 'Y') {phase += 3;}
+      auto ac = a*c;
+      check.set(q, ac.get(0));
+      phase += ac.phase() + (ac.get(0) == 'Y' ? 3 : 0);
+    }
+    phase += check.phase() - (check.phase() & 3);
+    unsigned ys = 0;
+    for(std::size_t q = 0; q < 128; q++) {if(check.get(q) == 'Y') {ys++;}}
+    check.setPhase(phase + ys);
+    if(check != w12) {is_error = true;}
+    if(w1.commutes(w2) != (w1*w2 == w2*w1)) {is_error = true;}
+  }
+  if(is_error == false) {
+    std::cout << "Passed Pauli product test." << std::endl;
+  } else {
+    std::cout << "Failed Pauli product test." << std::endl;
+  }
+}
+
+void test_sum_product() {
+  /* (A*B)|b> = A(B|b>) on every basis state of 5 qubits */
+  std::default_random_engine rand_gen(23);
+  std::uniform_real_distribution<double> urd(-1, 1);
+  const std::size_t q = 5;
+  const uint64_t dim = uint64_t(1) << q;
+  PauliSum<> A; PauliSum<> B; PauliSum<> C;
+  for(int i = 0; i < 40; i++) {
+    A.add(random_string<1>(q, rand_gen), V(urd(rand_gen), urd(rand_gen)));
+    B.add(random_string<1>(q, rand_gen), V(urd(rand_gen), urd(rand_gen)));
+  }
+  V s(0.5, 2);
+  C.pesAB(s, A, B);
+  auto apply = [&](const PauliSum<>& S, const std::vector<V>& x) {
+    std::vector<V> y(dim, 0);
+    for(auto& t : S.terms()) {
+      for(uint64_t b = 0; b < dim; b++) {
+        auto r = act(t.first, b);
+        y[r.second] += t.second*r.first*x[b];
+      }
+    }
+    return y;
+  };
+  bool is_error = false;
+  for(uint64_t b = 0; b < dim; b++) {
+    std::vector<V> e(dim, 0); e[b] = 1;
+    auto ab = apply(A, apply(B, e));
+    auto c = apply(C, e);
+    for(uint64_t r = 0; r < dim; r++) {
+      if(std::abs(c[r] - s*ab[r]) > 1.e-10) {is_error = true;}
+    }
+  }
+  /* coefficients read back through any phase of the string */
+  auto t = C.terms()[0];
+  PauliString<> p = t.first; p.setPhase(3);
+  if(std::abs(C.getCoeff(p)*V(0,-1) - t.second) > 1.e-12) {is_error = true;}
+  /* A*A of a Hermitian sum has no anti-Hermitian part left over */
+  PauliSum<> H; PauliSum<> H2;
+  for(int i = 0; i < 30; i++) {
+    H.add(random_string<1>(q, rand_gen).operator*=(PauliString<>()), 0);
+  }
+  for(auto& h : H.terms()) {H.add(h.first, urd(rand_gen));}
+  for(auto& h : H.terms()) {
+    /* strings of phase 0 with an odd number of Y are anti-Hermitian */
+    std::size_t ys = 0;
+    for(std::size_t k = 0; k < q; k++) {ys += h.first.get(k) == 'Y';}
+    if(ys & 1) {H.add(h.first, V(0, 1)*h.second - h.second);}
+  }
+  H2.pesAB(1, H, H);
+  H2.prune(1.e-12);
+  for(auto& h : H2.terms()) {
+    std::size_t ys = 0;
+    for(std::size_t k = 0; k < q; k++) {ys += h.first.get(k) == 'Y';}
+    V c = (ys & 1) ? h.second*V(0, -1) : h.second;
+    if(std::abs(c.imag()) > 1.e-10) {is_error = true;}
+  }
+  if(is_error == false) {
+    std::cout << "Passed Pauli sum product test." << std::endl;
+  } else {
+    std::cout << "Failed Pauli sum product test." << std::endl;
+  }
+}
+
+void test_collector() {
+  /* like terms collected against a std::map, through the growth of the
+  table, with a drop threshold and in sorted order */
+  std::default_random_engine rand_gen(41);
+  std::uniform_real_distribution<double> urd(-1, 1);
+  bool is_error = false;
+  TermCollector<2> terms(0.5);
+  std::map<PauliString<2>, V> check;
+  for(int i = 0; i < 20000; i++) {
+    auto p = random_string<2>(5, rand_gen);
+    p.set(100 + i%3, 'Y');
+    V c(urd(rand_gen), urd(rand_gen));
+    terms.add(p, c);
+    V cp = c*PauliString<2>::power(p.phase());
+    p.setPhase(0);
+    check[p] += cp;
+  }
+  auto out = terms.sorted();
+  std::size_t kept = 0;
+  for(auto& t : check) {kept += std::abs(t.second) > 0.5;}
+  if(terms.size() != check.size() || out.size() != kept) {is_error = true;}
+  for(std::size_t i = 0; i < out.size(); i++) {
+    if(out[i].first.phase() != 0) {is_error = true;}
+    if(i > 0 && !(out[i-1].first < out[i].first)) {is_error = true;}
+    if(std::abs(out[i].second - check[out[i].first]) > 1.e-10) {
+      is_error = true;
+    }
+  }
+  terms.clear();
+  if(terms.size() != 0 || !terms.sorted().empty()) {is_error = true;}
+  /* the dense array on 6 qubits gives what the table gives */
+  TermCollector<1> dense(0.5, 6);
+  TermCollector<1> hashed(0.5);
+  if(!dense.dense() || hashed.dense()) {is_error = true;}
+  for(int i = 0; i < 5000; i++) {
+    auto p = random_string<1>(6, rand_gen);
+    V c(urd(rand_gen), urd(rand_gen));
+    dense.add(p, c);
+    hashed.add(p, c);
+  }
+  auto dout = dense.sorted();
+  auto hout = hashed.sorted();
+  if(dense.size() != hashed.size() || dout.size() != hout.size()) {
+    is_error = true;
+  }
+  for(std::size_t i = 0; i < dout.size() && i < hout.size(); i++) {
+    if(dout[i].first != hout[i].first) {is_error = true;}
+    if(std::abs(dout[i].second - hout[i].second) > 1.e-10) {is_error = true;}
+  }
+  /* a commutator against the difference of the two products */
+  const std::size_t q = 5;
+  PauliSum<> A; PauliSum<> B; PauliSum<> C; PauliSum<> D;
+  for(int i = 0; i < 30; i++) {
+    A.add(random_string<1>(q, rand_gen), V(urd(rand_gen), urd(rand_gen)));
+    B.add(random_string<1>(q, rand_gen), V(urd(rand_gen), urd(rand_gen)));
+  }
+  C.pesComm(V(0, 2), A, B);
+  D.pesAB(V(0, 2), A, B);
+  D.pesAB(V(0, -2), B, A);
+  D.canonicalize(1.e-12);
+  auto c = C.terms();
+  auto d = D.terms();
+  if(c.size() != d.size()) {is_error = true;}
+  for(std::size_t i = 0; i < c.size() && i < d.size(); i++) {
+    if(c[i].first != d[i].first) {is_error = true;}
+    if(std::abs(c[i].second - d[i].second) > 1.e-10) {is_error = true;}
+    if(i > 0 && !(c[i-1].first < c[i].first)) {is_error = true;}
+  }
+  if(is_error == false) {
+    std::cout << "Passed Pauli term collection test." << std::endl;
+  } else {
+    std::cout << "Failed Pauli term collection test." << std::endl;
+  }
+}
+
+void test_to_csr() {
+  /* rows built in parallel against P|b> on every basis state, then fed
+  to Matrix for SpMV */
+  std::default_random_engine rand_gen(53);
+  std::uniform_real_distribution<double> urd(-1, 1);
+  const std::size_t q = 6;
+  const uint64_t dim = uint64_t(1) << q;
+  PauliSum<> H;
+  for(int i = 0; i < 60; i++) {
+    H.add(random_string<1>(q, rand_gen), V(urd(rand_gen), urd(rand_gen)));
+  }
+  std::vector<std::vector<V>> dense(dim, std::vector<V>(dim, 0));
+  for(auto& t : H.terms()) {
+    for(uint64_t b = 0; b < dim; b++) {
+      auto r = act(t.first, b);
+      dense[r.second][b] += t.second*r.first;
+    }
+  }
+  bool is_error = false;
+  CompressedMatrix<uint32_t,V> csr;
+  if(!H.toCSR(csr, q, 3, 1.e-12)) {is_error = true;}
+  if(csr.rows() != dim || csr.cols() != dim) {is_error = true;}
+  std::size_t nnz = 0;
+  for(uint64_t r = 0; r < dim; r++) {
+    for(uint64_t c = 0; c < dim; c++) {nnz += std::abs(dense[r][c]) > 1.e-12;}
+  }
+  if(csr.nnz() != nnz) {is_error = true;}
+  csr.forEach([&](uint32_t x, uint32_t y, const V& v) {
+    if(std::abs(v - dense[x][y]) > 1.e-10) {is_error = true;}
+  });
+  for(uint64_t r = 0; r < dim; r++) {
+    for(std::size_t i = csr.ptr()[r]+1; i < csr.ptr()[r+1]; i++) {
+      if(csr.idx()[i-1] >= csr.idx()[i]) {is_error = true;}
+    }
+  }
+  /* an X-mask or z bit past the qubits, a higher word, or more qubits
+  than the index holds: refused, and csr kept */
+  PauliSum<> xwide; xwide.add(PauliString<>({{dim}}, {{0}}), 1);
+  PauliSum<> zwide; zwide.add(PauliString<>({{1}}, {{dim}}), 1);
+  PauliSum<2> high; high.add(PauliString<2>({{0, 0}}, {{0, 1}}), 1);
+  if(xwide.toCSR(csr, q) || zwide.toCSR(csr, q) || high.toCSR(csr, q)
+    || H.toCSR(csr, 32)) {
+    is_error = true;
+  }
+  if(csr.rows() != dim || csr.nnz() != nnz) {is_error = true;}
+  Matrix m;
+  m.fromCSR(csr);
+  std::vector<V> x(dim); std::vector<V> y(dim);
+  for(auto& v : x) {v = V(urd(rand_gen), urd(rand_gen));}
+  m.apply(x.data(), y.data(), dim);
+  for(uint64_t r = 0; r < dim; r++) {
+    V check = 0;
+    for(uint64_t c = 0; c < dim; c++) {check += dense[r][c]*x[c];}
+    if(std::abs(check - y[r]) > 1.e-10) {is_error = true;}
+  }
+  if(is_error == false) {
+    std::cout << "Passed Pauli to CSR test." << std::endl;
+  } else {
+    std::cout << "Failed Pauli to CSR test." << std::endl;
+  }
+}
+void test_grouped() {
+  /* H*x by X-mask groups, built from the sum (both ways of summing a
+  group's diagonal) and from its Matrix, against the CSR of the sum, on
+  more rows than one tile and than one block */
+  std::default_random_engine rand_gen(61);
+  std::uniform_real_distribution<double> urd(-1, 1);
+  bool is_error = false;
+  for(std::size_t q : {3, 11, 14}) {
+    const uint64_t dim = uint64_t(1) << q;
+    PauliSum<> H;
+    for(int i = 0; i < 80; i++) {
+      H.add(random_string<1>(q, rand_gen), V(urd(rand_gen), urd(rand_gen)));
+    }
+    for(int i = 0; i < 40; i++) {
+      /* a crowded diagonal group and a crowded X-mask group */
+      PauliString<> p = random_string<1>(q, rand_gen);
+      PauliString<> zonly;
+      PauliString<> xfix;
+      for(std::size_t k = 0; k < q; k++) {
+        zonly.set(k, (p.z()[0] >> k) & 1 ? 'Z' : 'I');
+        xfix.set(k, k < 2 ? 'X' : zonly.get(k));
+      }
+      H.add(zonly, urd(rand_gen));
+      H.add(xfix, V(0, urd(rand_gen)));
+    }
+    for(uint64_t z = 1; z < 4; z++) {
+      /* a group of more terms than c_inline, fewer than q */
+      H.add(PauliString<>({{0b110}}, {{z}}), urd(rand_gen));
+    }
+    CompressedMatrix<uint32_t,V> csr;
+    H.toCSR(csr, q);
+    GroupedHamiltonian G;
+    G.setThreads(3);
+    if(!G.fromPauliSum(H, q)) {is_error = true;}
+    Matrix m;
+    m.fromCSR(csr);
+    GroupedHamiltonian F;
+    if(!F.fromMatrix(m, dim) || F.size() != G.size()) {is_error = true;}
+    std::vector<V> x(dim); std::vector<V> y(dim); std::vector<V> z(dim);
+    for(auto& v : x) {v = V(urd(rand_gen), urd(rand_gen));}
+    V alpha(-1.5, 0.25);
+    std::vector<V> hx(dim, 0);
+    csr.forEach([&](uint32_t r, uint32_t c, const V& v) {hx[r] += v*x[c];});
+    for(const GroupedHamiltonian* K : {&G, &F}) {
+      K->apply(x.data(), y.data());
+      std::fill(z.begin(), z.end(), V(2));
+      K->apply(alpha, x.data(), z.data());
+      for(uint64_t r = 0; r < dim; r++) {
+        if(std::abs(y[r] - hx[r]) > 1.e-9) {is_error = true;}
+        if(std::abs(z[r] - (V(2) + alpha*hx[r])) > 1.e-9) {is_error = true;}
+      }
+    }
+  }
+  Matrix odd;
+  odd.add(0, 2, 1);
+  GroupedHamiltonian E;
+  if(E.fromMatrix(odd, 3) || E.fromMatrix(odd, 2)) {is_error = true;}
+  /* strings reaching past the qubits, in either word, are refused */
+  PauliSum<> wide;
+  wide.add(PauliString<>({{0b1}}, {{0b1000}}), 1);
+  PauliSum<2> high;
+  high.add(PauliString<2>({{0, 1}}, {{0, 0}}), 1);
+  if(E.fromPauliSum(wide, 3) || !E.fromPauliSum(wide, 4)) {is_error = true;}
+  if(E.fromPauliSum(high, 8) || E.fromPauliSum(wide, 32)) {is_error = true;}
+  if(E.rows() != 16) {is_error = true;}
+  if(is_error == false) {
+    std::cout << "Passed grouped Hamiltonian test." << std::endl;
+  } else {
+    std::cout << "Failed grouped Hamiltonian test." << std::endl;
+  }
+}
+
+int main() {
+  test_string_table();
+  test_string_products();
+  test_sum_product();
+  test_collector();
+  test_to_csr();
+  test_grouped();
+  return 0;
+}
+/*
+
+*/
@@ -12,7 +12,7 @@
 #include <exception>
 #include <iterator>
 #include <stdexcept>
-#include "../Matrix.hpp"
+#include "../Matrix3.hpp"
 
 class Timer {
  private:
@@ -230,13 +230,14 @@ void test_trad_mult() {
     //std::cout << "start transpose" << std::endl;
     //A.transpose_emplace();
     //std::cout << "start pesABt" << std::endl;
-    C.pesAB(1,A,B,true);
+    C.symbolicAB(A,B);
+    C.numericAB(1);
     times_multM.push_back(stop_watch.get_time());
     std::cout << "compare_objects(c,C)=" << compare_objects(c,C) << std::endl;
     stop_watch.start();
     //C.clear();
     //std::cout << "start pesABt 2nd" << std::endl;
-    C.pesAB(1,A,B,false);
+    C.numericAB(1);
     times_mult_2M.push_back(stop_watch.get_time());
     std::cout << "compare_objects(c,C)=" << compare_objects(c,C) << std::endl;
     ////////////////////////////////////////////////
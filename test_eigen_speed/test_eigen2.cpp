@@ -12,7 +12,7 @@
 #include <exception>
 #include <iterator>
 #include <stdexcept>
-#include "../Matrix.hpp"
+#include "../Matrix2.hpp"
 
 class Timer {
  private:
@@ -101,9 +101,12 @@ Matrix& M) {
   std::advance(it,n);
   m.setFromTriplets(tri_vec.begin(), it);
   M.map_.clear();
+  std::vector<std::pair<Matrix::K,Matrix::V>> items(n);
   for(uint32_t i = 0; i < n; i++) {
-    M.add(tri_vec[i].col(),tri_vec[i].row(),tri_vec[i].value());
+    items[i] = {Matrix::K(tri_vec[i].col(),tri_vec[i].row()),
+      Matrix::V(tri_vec[i].value())};
   }
+  M.map_.try_emplace_range(items);
   //print_sparse("m=",m,M);
 }
 
@@ -278,6 +281,68 @@ void test_trad_mult() {
 }
 
 
+void test_spmv() {
+  /* transverse-field Ising Hamiltonian, sum Z_i Z_i+1 + sum X_i: one
+  diagonal and q bit-flip entries per row */
+  Timer stop_watch;
+  uint64_t min_qubits = 16;
+  uint64_t max_qubits = 20;
+  const int reps = 10;
+  for(uint64_t q = min_qubits; q <= max_qubits; q++) {
+    Matrix::Index dim = Matrix::Index(1) << q;
+    Matrix::CompressedT csr;
+    csr.reserve(std::size_t(dim)*(q+1));
+    for(Matrix::Index r = 0; r < dim; r++) {
+      double zz = 0;
+      for(uint64_t i = 0; i + 1 < q; i++) {
+        zz += (((r >> i) ^ (r >> (i+1))) & 1) ? -1 : 1;
+      }
+      /* columns in increasing order */
+      for(uint64_t i = q; i-- > 0;) {
+        if((r >> i) & 1) {
+          csr.append(r, r ^ (1u << i), 0.5);
+        }
+      }
+      csr.append(r, r, zz);
+      for(uint64_t i = 0; i < q; i++) {
+        if(!((r >> i) & 1)) {csr.append(r, r ^ (1u << i), 0.5);}
+      }
+    }
+    csr.resize(dim, dim);
+    Eigen::SparseMatrix<std::complex<double>> m(dim, dim);
+    {
+      TriVec tri_vec;
+      tri_vec.reserve(csr.nnz());
+      csr.forEach([&](Matrix::Index x, Matrix::Index y,
+        const std::complex<double>& v) {tri_vec.emplace_back(x, y, v);});
+      m.setFromTriplets(tri_vec.begin(), tri_vec.end());
+    }
+    Matrix M;
+    M.fromCSR(csr);
+    csr = Matrix::CompressedT();
+    Eigen::VectorXcd x = Eigen::VectorXcd::Random(dim);
+    Eigen::VectorXcd y(dim);
+    Eigen::VectorXcd z(dim);
+    y = m*x;
+    stop_watch.start();
+    for(int i = 0; i < reps; i++) {y.noalias() = m*x;}
+    double t_eigen = stop_watch.get_time();
+    M.apply(x.data(), z.data(), dim);
+    stop_watch.start();
+    for(int i = 0; i < reps; i++) {M.apply(x.data(), z.data(), dim);}
+    double t_apply = stop_watch.get_time();
+    M.setThreads(Parallel::hardware());
+    stop_watch.start();
+    for(int i = 0; i < reps; i++) {M.apply(x.data(), z.data(), dim);}
+    double t_threads = stop_watch.get_time();
+    std::cout << "q=" << q << " nnz=" << m.nonZeros()
+      << " log2(s) per 10 products: eigen=" << std::fixed << std::setprecision(3) << t_eigen
+      << " apply=" << t_apply << " apply(" << Parallel::hardware()
+      << " threads)=" << t_threads
+      << " |y-z|=" << std::scientific << (y-z).norm() << std::endl;
+  }
+}
+
 
 /*
 
@@ -332,5 +397,6 @@ int main() {
   }
   */
   test_trad_mult();
+  test_spmv();
   return 0;
 }
@@ -0,0 +1,88 @@
+/*
+  Copyright Benjamin Commeau
+
+Use CamelCase for all names. Start types (such as classes, structs, and typedefs) with a capital letter, other names (functions, variables) with a lowercase letter. You may use an all-lowercase name with underscores if your class closely resembles an external construct (e.g., a standard library construct) named that way.
+
+(1) C++ interfaces are named with a Interface suffix, and abstract base classes with an Abstract prefix.
+(2) Member variables are named with a trailing underscore.
+(3) Accessors for a variable foo_ are named foo() and setFoo().
+(4) Global variables are named with a g_ prefix.
+(5) Static class variables are named with a s_ prefix.
+(6) Global constants are often named with a c_ prefix.
+(7) If the main responsibility of a file is to implement a particular class, then the name of the file should match that class, except for possible abbreviations to avoid repetition in file names (e.g., if all classes within a module start with the module name, omitting or abbreviating the module name is OK). Currently, all source file names are lowercase, but this casing difference should be the only difference.
+
+The rationale for the trailing underscore and the global/static prefixes is that it is immediately clear whether a variable referenced in a method is local to the function or has wider scope, improving the readability of the code.
+*/
+
+#include <iostream>
+#include <complex>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "../Matrix2.hpp"
+#include "../MonomialMatrix.hpp"
+
+
+class Timer {
+ private:
+  std::chrono::time_point<std::chrono::high_resolution_clock>
+    start_ = std::chrono::high_resolution_clock::now();
+  std::chrono::time_point<std::chrono::high_resolution_clock>
+    end_ = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double>
+    duration_ = std::chrono::duration_cast
+    <std::chrono::nanoseconds>(end_-start_);
+ public:
+  void start() {
+    start_ = std::chrono::high_resolution_clock::now();
+  }
+  void stop(std::string statement) {
+    end_ = std::chrono::high_resolution_clock::now();
+    duration_ = std::chrono::duration_cast
+      <std::chrono::nanoseconds>(end_-start_);
+    std::cout << log2(duration_.count()) << " "+statement << std::endl;
+    start_ = std::chrono::high_resolution_clock::now();
+  }
+};
+
+typedef std::complex<double> V;
+typedef uint32_t I;
+
+void test_monomial_speed() {
+  /* SpMV of one Pauli string on 22 qubits, as MonomialMatrix and as
+  Matrix */
+  const std::size_t q = 22;
+  const I n = I(1) << q;
+  MonomialMatrix A;
+  if(!A.fromPauli(PauliString<>("XZIYXIZZXYIXZIYXXZYIZX"), q)) {
+    std::cout << "Failed monomial product test." << std::endl;
+    return;
+  }
+  Matrix m;
+  A.toMatrix(m);
+  std::vector<V> x(n, V(1, 0.5)); std::vector<V> y(n);
+  Timer stop_watch;
+  stop_watch.start();
+  for(int i = 0; i < 10; i++) {A.apply(x.data(), y.data());}
+  stop_watch.stop("MonomialMatrix 10 SpMV, 2^22 rows");
+  m.apply(x.data(), y.data(), n);
+  stop_watch.start();
+  for(int i = 0; i < 10; i++) {m.apply(x.data(), y.data(), n);}
+  stop_watch.stop("Matrix 10 SpMV, 2^22 rows");
+  stop_watch.start();
+  for(int i = 0; i < 10; i++) {A *= A;}
+  stop_watch.stop("MonomialMatrix 10 products, 2^22 rows");
+  /* the square of a Pauli string is the identity */
+  bool is_error = !A.masked() || A.mask() != 0;
+  for(I r = 0; r < n; r++) {if(A.val(r) != V(1)) {is_error = true;}}
+  if(is_error) {std::cout << "Failed monomial product test." << std::endl;}
+}
+
+int main() {
+  test_monomial_speed();
+  return 0;
+}
+/*
+
+*/
@@ -0,0 +1,215 @@
+/*
+  Copyright Benjamin Commeau
+
+Use CamelCase for all names. Start types (such as classes, structs, and typedefs) with a capital letter, other names (functions, variables) with a lowercase letter. You may use an all-lowercase name with underscores if your class closely resembles an external construct (e.g., a standard library construct) named that way.
+
+(1) C++ interfaces are named with a Interface suffix, and abstract base classes with an Abstract prefix.
+(2) Member variables are named with a trailing underscore.
+(3) Accessors for a variable foo_ are named foo() and setFoo().
+(4) Global variables are named with a g_ prefix.
+(5) Static class variables are named with a s_ prefix.
+(6) Global constants are often named with a c_ prefix.
+(7) If the main responsibility of a file is to implement a particular class, then the name of the file should match that class, except for possible abbreviations to avoid repetition in file names (e.g., if all classes within a module start with the module name, omitting or abbreviating the module name is OK). Currently, all source file names are lowercase, but this casing difference should be the only difference.
+
+The rationale for the trailing underscore and the global/static prefixes is that it is immediately clear whether a variable referenced in a method is local to the function or has wider scope, improving the readability of the code.
+*/
+
+#include <algorithm>
+#include <iostream>
+#include <complex>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <random>
+#include <map>
+#include <vector>
+#include "../GroupedHamiltonian.hpp"
+#include "../Matrix2.hpp"
+#include "../PauliSum.hpp"
+
+
+class Timer {
+ private:
+  std::chrono::time_point<std::chrono::high_resolution_clock>
+    start_ = std::chrono::high_resolution_clock::now();
+  std::chrono::time_point<std::chrono::high_resolution_clock>
+    end_ = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double>
+    duration_ = std::chrono::duration_cast
+    <std::chrono::nanoseconds>(end_-start_);
+ public:
+  void start() {
+    start_ = std::chrono::high_resolution_clock::now();
+  }
+  double seconds() {
+    end_ = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(end_-start_).count();
+  }
+};
+
+typedef std::complex<double> V;
+
+template<std::size_t W>
+PauliString<W> random_string(std::size_t qubits,
+  std::default_random_engine& rand_gen) {
+  std::uniform_int_distribution<int> uid(0, 3);
+  PauliString<W> p;
+  for(std::size_t q = 0; q < qubits; q++) {p.set(q, "IXYZ"[uid(rand_gen)]);}
+  p.setPhase(uid(rand_gen));
+  return p;
+}
+
+/* P|b> as (coefficient, b^x) on the first word */
+template<std::size_t W>
+std::pair<V,uint64_t> act(const PauliString<W>& p, uint64_t b) {
+  int sign = (std::popcount(p.z()[0] & b) & 1) ? -1 : 1;
+  return {double(sign)*PauliString<W>::power(p.phase()), b ^ p.x()[0]};
+}
+
+void test_sum_speed() {
+  /* two sums of 10^4 strings on 8 qubits, 10^8 string products that
+  collect into at most 4^8 terms */
+  std::default_random_engine rand_gen(31);
+  std::uniform_real_distribution<double> urd(-1, 1);
+  const std::size_t q = 8;
+  PauliSum<> A; PauliSum<> B; PauliSum<> C;
+  for(PauliSum<>* S : {&A, &B}) {
+    while(S->size() < 10000) {
+      S->add(random_string<1>(q, rand_gen), urd(rand_gen));
+    }
+  }
+  Timer stop_watch;
+  stop_watch.start();
+  C.pesAB(1, A, B);
+  double t = stop_watch.seconds();
+  std::cout << "Pauli sum product: " << A.size() << " x " << B.size()
+    << " terms -> " << C.size() << " terms in " << t << " s" << std::endl;
+  C.clear();
+  stop_watch.start();
+  C.pesComm(1, A, B);
+  t = stop_watch.seconds();
+  std::cout << "Pauli sum commutator: " << A.size() << " x " << B.size()
+    << " terms -> " << C.size() << " terms in " << t << " s" << std::endl;
+  /* 40 qubits, too many for the dense collector: 2*10^3 x 2*10^3 distinct
+  products through the hash table */
+  PauliSum<> D; PauliSum<> E; PauliSum<> F;
+  for(PauliSum<>* S : {&D, &E}) {
+    while(S->size() < 2000) {
+      S->add(random_string<1>(40, rand_gen), urd(rand_gen));
+    }
+  }
+  stop_watch.start();
+  F.pesAB(1, D, E);
+  t = stop_watch.seconds();
+  std::cout << "Pauli sum product: " << D.size() << " x " << E.size()
+    << " terms -> " << F.size() << " terms in " << t << " s" << std::endl;
+}
+
+void test_to_csr_speed() {
+  /* transverse-field Ising chain and random 2-local ZZ, XX couplings on
+  q qubits, against one Matrix::add per (term, row) */
+  std::default_random_engine rand_gen(59);
+  std::uniform_real_distribution<double> urd(-1, 1);
+  std::uniform_int_distribution<std::size_t> usite(0, 19);
+  for(std::size_t q : {12, 18, 24}) {
+    /* on 24 qubits the field acts on every fourth site and there are no
+    couplings, 7 groups and 117M nnz, 2.3 GB */
+    PauliSum<> H;
+    for(std::size_t k = 0; k < q; k++) {
+      PauliString<> zz; zz.set(k, 'Z'); zz.set((k+1)%q, 'Z');
+      PauliString<> x; x.set(k, 'X');
+      H.add(zz, urd(rand_gen));
+      if(q < 24 || k%4 == 0) {H.add(x, urd(rand_gen));}
+    }
+    for(int i = 0; i < (q < 24 ? 100 : 0); i++) {
+      PauliString<> p;
+      std::size_t a = usite(rand_gen)%q; std::size_t b = usite(rand_gen)%q;
+      p.set(a, 'X'); p.set(b, 'X'); p.set((a+b)%q, 'Z');
+      H.add(p, urd(rand_gen));
+    }
+    Timer stop_watch;
+    stop_watch.start();
+    CompressedMatrix<uint32_t,V> csr;
+    H.toCSR(csr, q, Parallel::hardware());
+    double t = stop_watch.seconds();
+    std::cout << "Pauli to CSR: " << q << " qubits, " << H.size()
+      << " terms, " << csr.nnz() << " nnz in " << t << " s" << std::endl;
+    if(q > 12) {continue;}
+    Matrix m;
+    stop_watch.start();
+    for(auto& term : H.terms()) {
+      for(uint64_t b = 0; b < (uint64_t(1) << q); b++) {
+        auto r = act(term.first, b);
+        m.add(r.second, b, term.second*r.first);
+      }
+    }
+    t = stop_watch.seconds();
+    std::cout << "Pauli by Matrix::add: " << q << " qubits, "
+      << m.map_.countLive() << " nnz in " << t << " s" << std::endl;
+  }
+}
+
+void test_grouped_speed() {
+  /* 10 products H*x on 20 qubits: the Ising chain with random 3-body
+  terms of test_to_csr_speed, plus every ZZ pair on the diagonal */
+  std::default_random_engine rand_gen(67);
+  std::uniform_real_distribution<double> urd(-1, 1);
+  std::uniform_int_distribution<std::size_t> usite(0, 19);
+  const std::size_t q = 20;
+  const uint64_t dim = uint64_t(1) << q;
+  PauliSum<> H;
+  for(std::size_t k = 0; k < q; k++) {
+    PauliString<> x; x.set(k, 'X');
+    H.add(x, urd(rand_gen));
+    for(std::size_t l = k+1; l < q; l++) {
+      PauliString<> zz; zz.set(k, 'Z'); zz.set(l, 'Z');
+      H.add(zz, urd(rand_gen));
+    }
+  }
+  for(int i = 0; i < 30; i++) {
+    PauliString<> p;
+    std::size_t a = usite(rand_gen); std::size_t b = usite(rand_gen);
+    p.set(a, 'X'); p.set(b, 'Y'); p.set((a+b)%q, 'Z');
+    H.add(p, urd(rand_gen));
+  }
+  Timer stop_watch;
+  stop_watch.start();
+  GroupedHamiltonian G;
+  if(!G.fromPauliSum(H, q)) {std::cout << "Failed grouping." << std::endl;}
+  double t = stop_watch.seconds();
+  CompressedMatrix<uint32_t,V> csr;
+  H.toCSR(csr, q);
+  std::size_t bytes = 0;
+  for(std::size_t g = 0; g < G.size(); g++) {
+    bytes += G.group(g).diag_.size()*sizeof(V);
+  }
+  std::cout << "Grouped Hamiltonian: " << H.size() << " terms, "
+    << G.size() << " groups, " << bytes/(1 << 20) << " MiB of diagonals, "
+    << "built in " << t << " s" << std::endl;
+  std::vector<V> x(dim, V(1, 0.5)); std::vector<V> y(dim);
+  stop_watch.start();
+  for(int i = 0; i < 10; i++) {G.apply(x.data(), y.data());}
+  t = stop_watch.seconds();
+  std::cout << "Grouped Hamiltonian: 10 SpMV in " << t << " s" << std::endl;
+  stop_watch.start();
+  for(int i = 0; i < 10; i++) {
+    for(uint64_t r = 0; r < dim; r++) {
+      y[r] = ComplexKernel::dot(csr.val().data() + csr.ptr()[r],
+        csr.idx().data() + csr.ptr()[r], csr.ptr()[r+1] - csr.ptr()[r],
+        x.data());
+    }
+  }
+  t = stop_watch.seconds();
+  std::cout << "CSR of " << csr.nnz() << " nnz: 10 SpMV in " << t << " s"
+    << std::endl;
+}
+
+int main() {
+  test_sum_speed();
+  test_to_csr_speed();
+  test_grouped_speed();
+  return 0;
+}
+/*
+
+*/